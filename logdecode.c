@@ -0,0 +1,61 @@
+/**
+ * @file logdecode.c
+ * @brief Converts a binary logfile of mmanage into the text format.
+ *
+ * The output is identical to the logfile mmanage writes in text mode,
+ * so it can be compared with the reference logfiles.
+ *
+ * Usage: logdecode [-counters] [binary logfile [text logfile]]
+ * Defaults: MMANAGE_LOGBINNAME and stdout.
+ * With -counters each event is followed by the counters that only the
+ * binary logfile records, the output then differs from the text format.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "logger.h"
+
+#define DECODE_BATCH 1024 //!< Number of events read with one fread
+
+int main(int argc, char **argv) {
+    int counters = (argc > 1) && (strcmp(argv[1], "-counters") == 0);
+    int nargs = argc - counters;
+    const char *in_name = (nargs > 1) ? argv[1 + counters] : MMANAGE_LOGBINNAME;
+    FILE *in = NULL;
+    FILE *out = stdout;
+    struct logfile_header hdr;
+    struct logevent events[DECODE_BATCH];
+    size_t n, i;
+
+    TEST_AND_EXIT(nargs > 3, (stderr, "Usage : %s [-counters] [binary logfile [text logfile]]\n", argv[0]));
+
+    in = fopen(in_name, "r");
+    TEST_AND_EXIT_ERRNO(!in, "Error opening binary logfile");
+    if (nargs > 2) {
+        out = fopen(argv[2 + counters], "w");
+        TEST_AND_EXIT_ERRNO(!out, "Error creating text logfile");
+    }
+
+    TEST_AND_EXIT(fread(&hdr, sizeof(hdr), 1, in) != 1, (stderr, "%s: missing header\n", in_name));
+    TEST_AND_EXIT(hdr.magic != LOGFILE_MAGIC, (stderr, "%s: not a binary logfile\n", in_name));
+    TEST_AND_EXIT(hdr.event_size != sizeof(struct logevent), 
+                  (stderr, "%s: event size %u does not match %zu\n", in_name, hdr.event_size, sizeof(struct logevent)));
+
+    while ((n = fread(events, sizeof(struct logevent), DECODE_BATCH, in)) > 0) {
+        for (i = 0; i < n; i++) {
+            log_format(out, events[i]);
+            if (counters) {
+                log_format_counters(out, events[i]);
+            }
+        }
+    }
+    TEST_AND_EXIT_ERRNO(ferror(in), "Error reading binary logfile");
+
+    fclose(in);
+    if (out != stdout) fclose(out);
+    return 0;
+}
+
+// EOF
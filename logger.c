@@ -5,29 +5,119 @@
  * @brief This modules implements the logger for pagefault events. 
  *        It is based on the logger function  of the reference 
  *        implementation of Wolfgang Fohl.
+ *
+ * In binary mode logger() only pushes the event into a lock-free single 
+ * producer / single consumer ring. A writer thread drains the ring into 
+ * MMANAGE_LOGBINNAME. logdecode converts this file into the text format.
  */
 
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 #include "logger.h"
 #include "debug.h"
 
+#define LOG_RING_SIZE  4096     //!< Number of events in the ring, power of two
+#define LOG_IDLE_NS    1000000  //!< Sleep time of the writer thread when the ring is empty
+
 static FILE *logfile = NULL;  //!< Reference to logfile
+static int log_mode = LOGGER_TEXT; //!< Selected logging mode
+
+static struct logevent ring[LOG_RING_SIZE]; //!< Ring of events not yet written (binary mode)
+static size_t ring_head = 0;  //!< Next slot to write, owned by the producer
+static size_t ring_tail = 0;  //!< Next slot to read, owned by the writer thread
+static int writer_stop = 0;   //!< Set by close_logger to terminate the writer thread
+static pthread_t writer;      //!< Writer thread (binary mode)
+
+/**
+ *****************************************************************************************
+ *  @brief      This function is the writer thread of the binary mode.
+ *
+ *  It drains the ring into the logfile. Contiguous events are written with one fwrite.
+ *  It terminates when writer_stop is set and the ring is empty.
+ *
+ *  @param      arg unused
+ *
+ *  @return     NULL
+ ****************************************************************************************/
+static void *log_writer(void *arg) {
+    struct timespec idle = { 0, LOG_IDLE_NS };
+    (void) arg;
+
+    while (1) {
+        int stop = __atomic_load_n(&writer_stop, __ATOMIC_ACQUIRE);
+        size_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+        size_t tail = ring_tail;
+
+        if (head == tail) {
+            if (stop) break;
+            nanosleep(&idle, NULL);
+            continue;
+        }
+        while (tail != head) {
+            size_t idx = tail & (LOG_RING_SIZE - 1);
+            size_t n = LOG_RING_SIZE - idx; // up to the end of the ring
+            if (n > head - tail) n = head - tail;
+            TEST_AND_EXIT_ERRNO(fwrite(&ring[idx], sizeof(struct logevent), n, logfile) != n,
+                                "Error writing binary logfile");
+            tail += n;
+        }
+        __atomic_store_n(&ring_tail, tail, __ATOMIC_RELEASE);
+    }
+    fflush(logfile);
+    return NULL;
+}
 
-void open_logger(void) {
+void open_logger(int mode) {
+    log_mode = mode;
+    if (log_mode == LOGGER_BINARY) {
+        struct logfile_header hdr = { LOGFILE_MAGIC, sizeof(struct logevent) };
+        logfile = fopen(MMANAGE_LOGBINNAME, "w");
+        TEST_AND_EXIT_ERRNO(!logfile, "Error creating binary logfile");
+        TEST_AND_EXIT_ERRNO(fwrite(&hdr, sizeof(hdr), 1, logfile) != 1, "Error writing binary logfile");
+        writer_stop = 0;
+        TEST_AND_EXIT(pthread_create(&writer, NULL, log_writer, NULL) != 0,
+                      (stderr, "Error creating logger thread\n"));
+        return;
+    }
     /* Open logfile */
     logfile = fopen(MMANAGE_LOGFNAME, "w");
     TEST_AND_EXIT_ERRNO(!logfile, "Error creating logfile");
 }
 
 void close_logger(void) {
+    if (log_mode == LOGGER_BINARY) {
+        __atomic_store_n(&writer_stop, 1, __ATOMIC_RELEASE);
+        pthread_join(writer, NULL);
+    }
     fclose(logfile);
 }
 
 /* Do not change!  */
-void logger(struct logevent le) {
-    fprintf(logfile, "Page fault %10d, Global count %10d:\n"
+void log_format(FILE *f, struct logevent le) {
+    fprintf(f, "Page fault %10d, Global count %10d:\n"
             "Removed: %10d, Allocated: %10d, Frame: %10d\n",
             le.pf_count, le.g_count,
             le.replaced_page, le.req_pageno, le.alloc_frame);
+}
+
+void log_format_counters(FILE *f, struct logevent le) {
+    fprintf(f, "Writebacks: %10d, Read-ahead useful: %10d, wasted: %10d\n",
+            le.wb_count, le.ra_useful, le.ra_wasted);
+}
+
+void logger(struct logevent le) {
+    if (log_mode == LOGGER_BINARY) {
+        size_t head = ring_head;
+        // ring full: wait for the writer, events must not be lost
+        while (head - __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE) == LOG_RING_SIZE) {
+            sched_yield();
+        }
+        ring[head & (LOG_RING_SIZE - 1)] = le;
+        __atomic_store_n(&ring_head, head + 1, __ATOMIC_RELEASE);
+        return;
+    }
+    log_format(logfile, le);
     fflush(logfile);
 }
 
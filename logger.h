@@ -9,6 +9,8 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include <stdio.h>
+
 /** 
  * Event struct for logging 
  */
@@ -18,21 +20,44 @@ struct logevent {
     int alloc_frame;   //!< selected frame
     int pf_count;      //!< current number of page faults
     int g_count;       //!< gobal quasi time stamp
+    int wb_count;      //!< current number of writebacks (binary logfile only, see log_format_counters)
+    int ra_useful;     //!< current number of referenced read ahead pages (binary logfile only, see log_format_counters)
+    int ra_wasted;     //!< current number of unreferenced evicted read ahead pages (binary logfile only, see log_format_counters)
 };
 
-#define MMANAGE_LOGFNAME "./logfile.txt"  //!< logfile name 
+#define MMANAGE_LOGFNAME   "./logfile.txt"  //!< logfile name 
+#define MMANAGE_LOGBINNAME "./logfile.bin"  //!< logfile name in binary mode
+
+/**
+ * Logging modes
+ */
+#define LOGGER_TEXT    0  //!< logger writes and flushes the text format for each event
+#define LOGGER_BINARY  1  //!< logger queues events, a writer thread stores them in binary form
+
+#define LOGFILE_MAGIC 0x474c4d56  //!< "VMLG", first word of a binary logfile
+
+/**
+ * Header of a binary logfile. It is followed by struct logevent records.
+ */
+struct logfile_header {
+    unsigned int magic;        //!< LOGFILE_MAGIC
+    unsigned int event_size;   //!< sizeof(struct logevent) of the writer
+};
 
 /**
  *****************************************************************************************
  *  @brief      This function creates a new logfile
  *
+ *  @param      mode LOGGER_TEXT or LOGGER_BINARY.
+ *
  *  @return     void 
  ****************************************************************************************/
-void open_logger(void);
+void open_logger(int mode);
 
 /**
  *****************************************************************************************
  *  @brief      This function closes the current logfile
+ *              In binary mode all queued events are written before.
  *
  *  @return     void 
  ****************************************************************************************/
@@ -48,4 +73,32 @@ void close_logger(void);
  ****************************************************************************************/
 void logger(struct logevent le);
 
+/**
+ *****************************************************************************************
+ *  @brief      This function writes a log entity in text format.
+ *              It will be used by logger and by logdecode.
+ *              The format is fixed, the logfiles are compared with the 
+ *              reference logfiles. The counters are in the binary format only.
+ *
+ *  @param      f File the entity should be written to.
+ *
+ *  @param      le This stucture describes the entity that should be logged.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void log_format(FILE *f, struct logevent le);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes the counters of a log entity that are
+ *              not part of the text format. It will be used by logdecode -counters.
+ *
+ *  @param      f File the counters should be written to.
+ *
+ *  @param      le This stucture describes the entity that should be logged.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void log_format_counters(FILE *f, struct logevent le);
+
 #endif /* LOGGER_H */
@@ -9,9 +9,61 @@
  * works together with the vmaccess process to
  * manage virtual memory management.
  *
- * The memory manager process will be invoked
- * via a SIGUSR1 signal. It maintains the page table
- * and provides the data pages in shared memory.
+ * The memory manager process waits for page faults
+ * posted via the fault channel in shared memory. It
+ * maintains the page table and provides the data pages
+ * in shared memory.
+ *
+ * If free frame watermarks are set, a cleaner thread
+ * evicts pages when a request leaves no more than
+ * -lowfree frames free, until -highfree frames are free,
+ * so faults take a free frame at once and write nothing
+ * back. It clears PTF_DIRTY atomically before it copies
+ * a page, and the client sets PTF_DIRTY atomically after
+ * it has written, so a write the copy missed leaves the
+ * page dirty. The client may still access an evicted
+ * page through an entry of its TLB that it validated
+ * just before the eviction. The frame is only reused by
+ * the next request, which the client waits for, so the
+ * request first writes back the pages evicted since the
+ * last one that became dirty again, and invalidates the
+ * TLB entries of their frames once more (settle_evicted).
+ * LRU and Aging update their state on each access of the
+ * client (PAGEREP_NEEDS_ACCESS), so with them the fault
+ * that finds fewer than -lowfree free frames evicts the
+ * pages, and the cleaner only writes dirty pages back.
+ *
+ * Sequential faults start read-ahead (-readahead): the
+ * pages behind the requested one are fetched in the same
+ * fault. The window doubles on each sequential fault and
+ * is halved when pages read ahead were evicted unused.
+ *
+ * The application may advise how it will access a range
+ * of pages (vmem_advise). The advice is posted via the
+ * fault channel as well and taken while the client
+ * waits: random pages are never read ahead, sequential
+ * pages get the full window at the first fault, pages
+ * that will be needed get free frames at once and pages that
+ * are not needed are written back and replaced first.
+ * The pages that will be needed are read by the I/O
+ * threads after the client has been answered, and 
+ * become present when their read has completed: the
+ * frame is published before PTF_PRESENT is set with
+ * release ordering. Each request waits for these reads 
+ * first, so the page table is complete while it is
+ * served. A fault on a page whose read was in flight
+ * finds it present then and only logs the fault.
+ *
+ * Pages locked by the application (vmem_lock) are read in
+ * if needed and never replaced until they are unlocked. 
+ * At most -maxlocked pages may be locked, a lock request
+ * beyond this limit is refused as a whole.
+ *
+ * Page faults are served by a dedicated fault service
+ * thread. The main thread only waits for SIGINT and
+ * SIGUSR2 via sigwait, so no work is done in signal
+ * context. A fault is never interrupted: the main thread
+ * acts on a signal between two faults.
  *
  * This process starts shared memory, so
  * it has to be started prior to the vmaccess process.
@@ -20,14 +72,17 @@
 
 #include "mmanage.h"
 #include "debug.h"
+#include "vmaccess.h"
 #include "pagefile.h"
 #include "logger.h"
 #include "vmem.h"
+#include "pagerep.h"
 #include "pthread.h"
+#include <time.h>
+#include <errno.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
-#define SNAME "semaphore"
 /*
  * Signatures of private / static functions
  */
@@ -46,15 +101,28 @@ static void fetch_page(int pt_idx);
 
 /**
  *****************************************************************************************
- *  @brief      This function writes a page into the pagefile.
+ *  @brief      This function writes the page held by a frame into the pagefile.
  *
  * It is mainly a wrapper of the corresponding function of module pagefile.c
  *
- *  @param      pt_idx Index of the page that should be written into the pagefile.
+ *  @param      frame Frame whose page should be written into the pagefile.
+ * 
+ *  @return     void 
+ ****************************************************************************************/
+static void store_page(int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes back a page queued by the page replacement 
+ *              algorithm. It is the writeback function in the admin data.
+ *
+ *  @param      ctx Unused.
+ *
+ *  @param      frame The frame of the page.
  * 
  *  @return     void 
  ****************************************************************************************/
-static void store_page(int pt_idx);
+static void writeback_page(void *ctx, int frame);
 
 /**
  *****************************************************************************************
@@ -69,98 +137,219 @@ static void vmem_init(void);
 
 /**
  *****************************************************************************************
- *  @brief      This function finds an unused frame.
+ *  @brief      This function allocates a new page into memory. If all frames are in 
+ *              use the corresponding page replacement algorithm will be called.
  *
- *  The framepage array of pagetable marks unused frames with VOID_IDX. 
- *  Based on this information find_free_frame searchs in vmem->pt.framepage for the 
- *  free frame with the smallest frame number.
+ *  allocate_page gets the requested page via vmem->adm.req_pageno. Please take into
+ *  account that allocate_page must update the page table and log the page fault 
+ *  as well.
+ *  allocate_page does all actions that must be down when the fault channel 
+ *  indicates a page fault. A page read in for an advice after the application found
+ *  it absent is present already, then the fault is only logged.
  *
- *  @return     idx of the unused frame with the smallest idx. 
- *              If all frames are in use, VOID_IDX will be returned.
+ *  @return     void 
  ****************************************************************************************/
-static int find_free_frame();
+static void allocate_page(void);
 
 /**
  *****************************************************************************************
- *  @brief      This function update the page table for page vmem->adm.req_pageno.
- *              It will be stored in frame.
+ *  @brief      This function takes an access advice of the application.
  *
- *  @param      frame The frame that stores the now allocated page vmem->adm.req_pageno.
+ *  advise_pages gets the range via vmem->adm.req_pageno and vmem->adm.req_npages and
+ *  the advice via vmem->adm.req_advice. It does all actions that must be done when 
+ *  the fault channel indicates an advice.
  *
  *  @return     void 
  ****************************************************************************************/
-static void update_pt(int frame);
+static void advise_pages(void);
 
 /**
  *****************************************************************************************
- *  @brief      This function allocates a new page into memory. If all frames are in 
- *              use the corresponding page replacement algorithm will be called.
+ *  @brief      This function locks or unlocks the pages of a lock request.
  *
- *  allocate_page gets the requested page via vmem->adm.req_pageno. Please take into
- *  account that allocate_page must update the page table and log the page fault 
- *  as well.
- *  allocate_page does all actions that must be down when the SIGUSR1 signal 
- *  indicates a page fault.
+ *  lock_pages gets the range via vmem->adm.req_pageno and vmem->adm.req_npages. Pages
+ *  to be locked that are not present are read in. If more than lock_max pages would 
+ *  be locked, no page is locked and vmem->adm.req_result is set to VOID_IDX.
  *
  *  @return     void 
  ****************************************************************************************/
-static void allocate_page(void);
+static void lock_pages(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function evicts pages until need frames are free, or free_high 
+ *              frames if less than free_low frames are free and the cleaner thread
+ *              does not evict.
+ *
+ *  Locked pages are not evicted, so it stops early if all other frames are free. 
+ *  Dirty pages are written back, most of them have been written by the cleaner thread
+ *  before. It is called by allocate_page while the application waits for the page fault.
+ *
+ *  @param      need Number of frames the page fault needs free, at most nframes.
+ *
+ *  @param      page The faulting page, VOID_IDX if frames are needed for an advice or 
+ *              lock request.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void clean_frames(int need, int page);
 
 /**
  *****************************************************************************************
- *  @brief      This function is the signal handler attached to system call sigaction
- *              for signal SIGUSR1, SIGUSR2 aund SIGINT.
+ *  @brief      This function is the cleaner thread. It runs if free frame watermarks
+ *              are set.
  *
- * These three signals have the same signal handler. Based on the parameter signo the 
- * corresponding action will be started.
+ *  A request that leaves no more than free_low frames free sets clean_pending under
+ *  clean_lock, so the wakeup is not lost while the cleaner is busy. The cleaner then
+ *  evicts pages until free_high frames are free (evict_page), if the policy allows.
+ *  Every MMANAGE_CLEAN_INTERVAL_MS it writes up to free_high dirty pages back. Its 
+ *  hand moves round the frames. Locked pages are written back as well, the application
+ *  may keep writing them, but when they are unlocked and replaced they are mostly 
+ *  clean. service_lock is held for one page at a time, so the page stays in its frame
+ *  while it is written and faults are served in between.
  *
- *  @param      signo Current signal that has be be handled.
+ *  @param      arg unused
  * 
+ *  @return     NULL, the thread runs until the process exits.
+ ****************************************************************************************/
+static void *page_cleaner(void *arg);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function evicts one page for the cleaner thread, which holds 
+ *              service_lock. The page is written back if it is dirty and its frame 
+ *              becomes free. The page is noted for settle_evicted.
+ *
  *  @return     void 
  ****************************************************************************************/
-static void sighandler(int signo);
+static void evict_page(void);
 
 /**
  *****************************************************************************************
- *  @brief      This function dumps the page table to stderr.
+ *  @brief      This function settles the pages the cleaner thread has evicted since the
+ *              last request. It is called first by each request.
+ *
+ *  The application may have written a page after the cleaner copied it, through a TLB
+ *  entry validated before the eviction. Such a page is dirty again, its frame still
+ *  holds it and it is written back now. The generation of each frame is incremented 
+ *  again, so TLB entries loaded while the page was evicted are invalid before the frame
+ *  is reused.
  *
  *  @return     void 
  ****************************************************************************************/
-static void dump_pt(void);
+static void settle_evicted(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function clears PTF_DIRTY of a page atomically, as the application
+ *              may set it at the same time.
+ *
+ *  @param      page The page.
+ *
+ *  @return     TRUE if the page was dirty, it must be written back then.
+ ****************************************************************************************/
+static int clear_dirty(int page);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function adapts the read-ahead window to the fault on page and 
+ *              counts the pages of the window that are not present.
+ *
+ *  A fault on the page behind the last fault or behind the last window is sequential.
+ *  It doubles the window up to ra_max, or halves it if pages read ahead have been 
+ *  evicted unused since the last fault. Any other fault closes the window.
+ *  Pages advised random get no window, pages advised sequential the full window.
+ *
+ *  @param      page The requested page.
+ *
+ *  @return     Number of pages to read ahead.
+ ****************************************************************************************/
+static int readahead_window(int page);
 
 /**
  *****************************************************************************************
- *  @brief      This function implements page replacement algorithm aging.
+ *  @brief      This function counts the pages from first to last that are not present.
+ *
+ *  @param      first First page, the range is clipped to the virtual address space.
+ *
+ *  @param      last Last page.
  *
- *  @return     idx of the page that should be replaced.
+ *  @return     Number of pages that are not present.
  ****************************************************************************************/
-static int find_remove_aging(void);
+static int absent_pages(int first, int last);
 
 /**
  *****************************************************************************************
- *  @brief      This function implements page replacement algorithm fifo.
+ *  @brief      This function reads the pages from first to last that are not present 
+ *              into free frames, until no frame is free. 
+ *
+ *  @param      first First page, the range is clipped to the virtual address space.
+ *
+ *  @param      last Last page.
+ *
+ *  @param      async FALSE: the pages are read before this function returns. TRUE: the
+ *              I/O threads read them, each page becomes present by publish_page.
  *
- *  @return     idx of the page that should be replaced.
+ *  @return     void 
  ****************************************************************************************/
-static int find_remove_fifo(void);
+static void prefetch_pages(int first, int last, int async);
 
 /**
  *****************************************************************************************
- *  @brief      This function implements page replacement algorithm clock.
+ *  @brief      This function makes a page read by an I/O thread present. It is called
+ *              by the I/O thread.
+ *
+ *  The frame of the page has been set when the read was queued, PTF_PRESENT is set with
+ *  release ordering, so the application that sees it also sees the frame and the data.
  *
- *  @return     idx of the page that should be replaced.
+ *  @param      pt_idx Index of the page.
+ *
+ *  @return     void 
  ****************************************************************************************/
-static int find_remove_clock(void);
+static void publish_page(int pt_idx);
 
 /**
  *****************************************************************************************
- *  @brief      This function selects and starts a page replacement algorithm.
+ *  @brief      This function is the fault service thread.
  *
- *  It is just a wrapper for the three page replacement algorithms.
+ *  It takes the page faults out of the fault channel and serves them by allocate_page,
+ *  advice requests by advise_pages and lock requests by lock_pages.
+ *  Each fault is served with service_lock held, so the main thread can stop the
+ *  service between two faults.
+ *
+ *  @param      arg unused
+ * 
+ *  @return     NULL, the thread runs until the process exits.
+ ****************************************************************************************/
+static void *fault_service(void *arg);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function waits for SIGUSR2 and SIGINT and handles them.
+ *
+ *  The signals are blocked in all threads and received here via sigwait. SIGUSR2 
+ *  dumps the page table, SIGINT requests the shutdown: this function returns after 
+ *  the running fault has been served, and the fault service stays stopped.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void wait_for_signals(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function dumps the page table to stderr.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void dump_pt(void);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints the access statistics to stderr.
  *
- *  @return     The idx of the page that should be replaced.
+ *  @return     void 
  ****************************************************************************************/
-static int find_remove_frame(void);
+static void dump_stats(void);
 
 /**
  *****************************************************************************************
@@ -173,7 +362,8 @@ static void cleanup(void) ;
 /**
  *****************************************************************************************
  *  @brief      This function scans all parameters of the porgram.
- *              The corresponding global variables vmem->adm.page_rep_algo will be set.
+ *              The corresponding global variables page_rep_algo, pagesize, 
+ *              virtmemsize and nframes will be set.
  * 
  *  @param      argc number of parameter 
  *
@@ -199,110 +389,334 @@ static void print_usage_info_and_exit(char *err_str);
  */
 
 static struct vmem_struct *vmem;// = NULL; //!< Reference to shared memory
-static int signal_number = 0;           //!< Number of signal received last
-static sem_t *local_sem = NULL;                //!< OS-X Named semaphores will be stored locally due to pointer
+static struct pt_struct pt;             //!< Page table arrays in shared memory
+static int *vmem_data;                  //!< Main memory in shared memory
+static char *program_name = NULL;       //!< Name of this program
+static unsigned char page_rep_algo = VMEM_ALGO_CLOCK; //!< Selected page replacement algorithm
+static int pagesize    = VMEM_PAGESIZE;    //!< Selected page size
+static int virtmemsize = VMEM_VIRTMEMSIZE; //!< Selected size of virtual address space
+static int nframes     = VMEM_PHYSMEMSIZE / VMEM_PAGESIZE; //!< Selected number of frames
+static int pf_backend  = PAGEFILE_PIO;      //!< Selected pagefile backend
+static int pf_threads  = PAGEFILE_IO_THREADS; //!< Number of I/O threads of the pagefile
+static int pf_advice   = PAGEFILE_ADV_NONE; //!< madvise hint for the mmap pagefile backend
+static int log_mode    = LOGGER_TEXT;       //!< Selected logging mode
+static int ws_tau      = VMEM_WS_TAU;       //!< Working set window of WSClock
+static int free_low    = 0;                 //!< Free frame low watermark, 0: no cleaning
+static int free_high   = 0;                 //!< Free frame high watermark
+static int clean_count = 0;                 //!< Pages evicted ahead of need
+static int clean_writes = 0;                //!< Pages written back by the cleaner thread
+static int clean_evicts = FALSE;            //!< The cleaner thread evicts pages, the policy has no on_access
+static int *evicted = NULL;                 //!< Pages evicted by the cleaner thread since the last request
+static int nevicted = 0;                    //!< Number of pages in evicted
+static int clean_hand  = 0;                 //!< Next frame the cleaner thread checks
+static pthread_mutex_t clean_lock = PTHREAD_MUTEX_INITIALIZER; //!< Mutex of clean_wakeup
+static pthread_cond_t clean_wakeup = PTHREAD_COND_INITIALIZER;  //!< Signalled when few frames are free
+static int clean_pending = FALSE;           //!< Set under clean_lock when a request left few frames free
+static int ra_max      = 0;                 //!< Maximal read-ahead window, 0: no read-ahead
+static int ra_window   = 0;                 //!< Current read-ahead window
+static int ra_last     = VOID_IDX;          //!< Page of the last fault
+static int ra_next     = VOID_IDX;          //!< Page behind the last read-ahead window
+static int ra_wasted_seen = 0;              //!< adm.ra_wasted at the last fault
+static int lock_max    = VOID_IDX;          //!< Maximal number of locked pages, VOID_IDX: nframes / 2
+static int lock_peak   = 0;                 //!< Most pages locked at a time
+static int lock_refused = 0;                //!< Lock requests refused because of lock_max
+static unsigned char *page_advice = NULL;   //!< VMEM_ADV_NORMAL, _RANDOM or _SEQUENTIAL of each page
+static pthread_mutex_t service_lock = PTHREAD_MUTEX_INITIALIZER; //!< Held while a page fault is served
 pid_t mmanage_id;
 int replacedFrame;
 
 int main(int argc, char **argv) {
-    struct sigaction sigact;
-
-    init_pagefile(); // init page file
-    open_logger();   // open logfile
-
-    /* Create shared memory and init vmem structure */
-    vmem_init();
-    TEST_AND_EXIT_ERRNO(!vmem, "Error initialising vmem");
-    PRINT_DEBUG((stderr, "vmem successfully created\n"));
+    sigset_t sigs;
+    pthread_t service;
+    pthread_t cleaner;
 
     // scan parameter 
-    vmem->adm.program_name = argv[0];
-    vmem->adm.page_rep_algo = VMEM_ALGO_CLOCK;
+    program_name = argv[0];
     scan_params(argc, argv);
 
-    /* Setup signal handler */
-    sigact.sa_handler = sighandler;
-    sigemptyset(&sigact.sa_mask);
-    sigact.sa_flags = 0;
-
-    TEST_AND_EXIT_ERRNO(sigaction(SIGUSR1, &sigact, NULL) == -1, "Error installing signal handler for USR1");
-    PRINT_DEBUG((stderr, "USR1 handler successfully installed\n"));
+    /* Block the signals before any thread is created, all threads inherit the mask */
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGUSR2);
+    sigaddset(&sigs, SIGINT);
+    TEST_AND_EXIT(pthread_sigmask(SIG_BLOCK, &sigs, NULL) != 0, (stderr, "Error blocking signals\n"));
 
-    TEST_AND_EXIT_ERRNO(sigaction(SIGUSR2, &sigact, NULL) == -1, "Error installing signal handler for USR2");
-    PRINT_DEBUG((stderr,  "USR2 handler successfully installed\n"));
+    init_pagefile(pagesize, virtmemsize / pagesize, pf_backend, pf_advice, pf_threads); // init page file
+    open_logger(log_mode);   // open logfile
 
-    TEST_AND_EXIT_ERRNO(sigaction(SIGINT, &sigact, NULL) == -1, "Error installing signal handler for INT");
-    PRINT_DEBUG((stderr, "INT handler successfully installed\n"));
+    /* Create shared memory and init vmem structure */
+    vmem_init();
+    TEST_AND_EXIT_ERRNO(!vmem, "Error initialising vmem");
+    PRINT_DEBUG((stderr, "vmem successfully created\n"));
 
-    /* Signal processing loop */
-    while(1) {
-        signal_number = 0;
-        pause();
-        if(signal_number == SIGUSR1) {  /* Page fault */
-            PRINT_DEBUG((stderr, "Processed SIGUSR1\n"));
-            signal_number = 0;
-        }
-        else if(signal_number == SIGUSR2) {     /* PT dump */
-            PRINT_DEBUG((stderr, "Processed SIGUSR2\n"));
-            signal_number = 0;
-        }
-        else if(signal_number == SIGINT) {
-            PRINT_DEBUG((stderr, "Processed SIGINT\n"));
-        }
+    TEST_AND_EXIT(pthread_create(&service, NULL, fault_service, NULL) != 0,
+                  (stderr, "Error creating fault service thread\n"));
+    PRINT_DEBUG((stderr, "Fault service thread started\n"));
+    if (free_high > 0) {
+        TEST_AND_EXIT(pthread_create(&cleaner, NULL, page_cleaner, NULL) != 0,
+                      (stderr, "Error creating cleaner thread\n"));
+        PRINT_DEBUG((stderr, "Cleaner thread started\n"));
     }
 
+    wait_for_signals();
+    cleanup();
     return 0;
 }
 
 void scan_params(int argc, char **argv) {
     int i = 0;
+    int algo;
     unsigned char param_ok = FALSE;
+    unsigned char algo_param_found = FALSE;
+    unsigned char frames_param_found = FALSE;
+    const char *pagesize_str = "-pagesize=";
+    const char *virtmem_str = "-virtmemsize=";
+    const char *frames_str = "-frames=";
 
     // scan all parameters (argv[0] points to program name)
-    if (argc > 2) print_usage_info_and_exit("Wrong number of parameters.\n");
-
     for (i = 1; i < argc; i++) {
         param_ok = FALSE;
-        if (0 == strcasecmp("-fifo", argv[i])) {
-            // page replacement strategies fifo selected 
-            vmem->adm.page_rep_algo = VMEM_ALGO_FIFO;
+        if (argv[i][0] == '-' && (algo = pagerep_find_policy(argv[i] + 1)) != VOID_IDX) {
+            // page replacement strategy selected by its name
+            page_rep_algo = algo;
+            param_ok = TRUE;
+        }
+        if (param_ok) {
+            if (algo_param_found) print_usage_info_and_exit("Two page replacement algorithms selected.\n");
+            algo_param_found = TRUE;
+        }
+        if (0 == strncasecmp(pagesize_str, argv[i], strlen(pagesize_str))) {
+            param_ok = (1 == sscanf(argv[i] + strlen(pagesize_str), "%d", &pagesize)) && (pagesize > 0);
+        }
+        if (0 == strncasecmp(virtmem_str, argv[i], strlen(virtmem_str))) {
+            param_ok = (1 == sscanf(argv[i] + strlen(virtmem_str), "%d", &virtmemsize)) && (virtmemsize > 0);
+        }
+        if (0 == strncasecmp("-tau=", argv[i], strlen("-tau="))) {
+            param_ok = (1 == sscanf(argv[i] + strlen("-tau="), "%d", &ws_tau)) && (ws_tau > 0);
+        }
+        if (0 == strncasecmp("-lowfree=", argv[i], strlen("-lowfree="))) {
+            param_ok = (1 == sscanf(argv[i] + strlen("-lowfree="), "%d", &free_low)) && (free_low >= 0);
+        }
+        if (0 == strncasecmp("-highfree=", argv[i], strlen("-highfree="))) {
+            param_ok = (1 == sscanf(argv[i] + strlen("-highfree="), "%d", &free_high)) && (free_high >= 0);
+        }
+        if (0 == strncasecmp("-maxlocked=", argv[i], strlen("-maxlocked="))) {
+            param_ok = (1 == sscanf(argv[i] + strlen("-maxlocked="), "%d", &lock_max)) && (lock_max >= 0);
+        }
+        if (0 == strncasecmp("-readahead=", argv[i], strlen("-readahead="))) {
+            param_ok = (1 == sscanf(argv[i] + strlen("-readahead="), "%d", &ra_max)) && (ra_max >= 0);
+        }
+        if (0 == strncasecmp(frames_str, argv[i], strlen(frames_str))) {
+            param_ok = (1 == sscanf(argv[i] + strlen(frames_str), "%d", &nframes)) && (nframes > 0);
+            frames_param_found = TRUE;
+        }
+        if (0 == strcasecmp("-pagefile=pio", argv[i])) {
+            pf_backend = PAGEFILE_PIO;
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-pagefile=mmap", argv[i])) {
+            pf_backend = PAGEFILE_MMAP;
+            param_ok = TRUE;
+        }
+        if (0 == strncasecmp("-iothreads=", argv[i], strlen("-iothreads="))) {
+            param_ok = (1 == sscanf(argv[i] + strlen("-iothreads="), "%d", &pf_threads)) && (pf_threads >= 0);
+        }
+        if (0 == strcasecmp("-log=text", argv[i])) {
+            log_mode = LOGGER_TEXT;
             param_ok = TRUE;
         }
-        if (0 == strcasecmp("-clock", argv[i])) {
-            // page replacement strategies clock selected 
-            vmem->adm.page_rep_algo = VMEM_ALGO_CLOCK;
+        if (0 == strcasecmp("-log=binary", argv[i])) {
+            log_mode = LOGGER_BINARY;
             param_ok = TRUE;
         }
-        if (0 == strcasecmp("-aging", argv[i])) {
-            // page replacement strategies aging selected 
-            vmem->adm.page_rep_algo = VMEM_ALGO_AGING;
+        if (0 == strncasecmp("-pfadvise=", argv[i], strlen("-pfadvise="))) {
+            const char *adv = argv[i] + strlen("-pfadvise=");
             param_ok = TRUE;
+            if      (0 == strcasecmp("none", adv))       pf_advice = PAGEFILE_ADV_NONE;
+            else if (0 == strcasecmp("normal", adv))     pf_advice = PAGEFILE_ADV_NORMAL;
+            else if (0 == strcasecmp("random", adv))     pf_advice = PAGEFILE_ADV_RANDOM;
+            else if (0 == strcasecmp("sequential", adv)) pf_advice = PAGEFILE_ADV_SEQUENTIAL;
+            else if (0 == strcasecmp("willneed", adv))   pf_advice = PAGEFILE_ADV_WILLNEED;
+            else param_ok = FALSE;
         }
         if (!param_ok) print_usage_info_and_exit("Undefined parameter.\n"); // undefined parameter found
     } // for loop
+
+    if (virtmemsize % pagesize != 0) print_usage_info_and_exit("Virtual memory size is not a multiple of the page size.\n");
+    if (!frames_param_found) {
+        // default: physical memory of VMEM_PHYSMEMSIZE ints
+        nframes = VMEM_PHYSMEMSIZE / pagesize;
+        if (nframes < 1) nframes = 1;
+    }
+    if (free_high < free_low) free_high = free_low;
+    if (free_high >= nframes) print_usage_info_and_exit("Free frame watermarks must be less than the number of frames.\n");
+    if (ra_max >= nframes) print_usage_info_and_exit("Read-ahead window must be less than the number of frames.\n");
+    if (lock_max == VOID_IDX) lock_max = nframes / 2;
+    if (lock_max >= nframes) print_usage_info_and_exit("Locked pages must be less than the number of frames.\n");
 }
 
 void print_usage_info_and_exit(char *err_str) {
+    int i;
     fprintf(stderr, "Wrong parameter: %s\n", err_str);
-    fprintf(stderr, "Usage : %s [OPTIONS]\n", vmem->adm.program_name);
-    fprintf(stderr, " -fifo     : Fifo page replacement algorithm.\n");
-    fprintf(stderr, " -clock    : Clock page replacement algorithm.\n");
-    fprintf(stderr, " -aging    : Aging page replacement algorithm.\n");
-    fprintf(stderr, " -pagesize=[8,16,32,64] : Page size.\n");
+    fprintf(stderr, "Usage : %s [OPTIONS]\n", program_name);
+    for (i = 0; i < PAGEREP_NPOLICIES; i++) {
+        fprintf(stderr, " -%-8s : %s\n", pagerep_policies[i].name, pagerep_policies[i].help);
+    }
+    fprintf(stderr, " -tau=<int>         : Working set window of WSClock in accesses (default %d).\n", VMEM_WS_TAU);
+    fprintf(stderr, " -pagesize=<int>    : Page size (default %d).\n", VMEM_PAGESIZE);
+    fprintf(stderr, " -virtmemsize=<int> : Size of virtual address space, multiple of page size (default %d).\n", VMEM_VIRTMEMSIZE);
+    fprintf(stderr, " -frames=<int>      : Number of page frames (default %d / page size).\n", VMEM_PHYSMEMSIZE);
+    fprintf(stderr, " -lowfree=<int>     : Evict pages on a fault that finds less free frames (default 0, off).\n");
+    fprintf(stderr, "                      A cleaner thread writes dirty pages back in the background.\n");
+    fprintf(stderr, " -highfree=<int>    : Number of free frames after eviction (default -lowfree).\n");
+    fprintf(stderr, " -readahead=<int>   : Read up to <int> pages ahead on sequential faults (default 0, off).\n");
+    fprintf(stderr, " -maxlocked=<int>   : Pages the application may lock in memory (default frames / 2).\n");
+    fprintf(stderr, " -pagefile=[pio,mmap] : Pagefile backend, pread / pwrite or mmap (default pio).\n");
+    fprintf(stderr, " -iothreads=<int>   : Threads that write and read ahead pages, 0: synchronous I/O (default %d).\n", PAGEFILE_IO_THREADS);
+    fprintf(stderr, " -pfadvise=[none,normal,random,sequential,willneed] : madvise hint for mmap backend.\n");
+    fprintf(stderr, " -log=[text,binary] : Write %s, or queue events for a writer thread\n", MMANAGE_LOGFNAME);
+    fprintf(stderr, "                      that stores them in %s (see logdecode).\n", MMANAGE_LOGBINNAME);
     fflush(stderr);
     exit(EXIT_FAILURE);
 }
 
-void sighandler(int signo) {
-    signal_number = signo;
-    if(signo == SIGUSR1) {
-        allocate_page();
-    } else if(signo == SIGUSR2) {
+void *fault_service(void *arg) {
+    (void) arg;
+
+    /* Page fault processing loop */
+    while(1) {
+        fault_wait_request(&vmem->adm);
+        pthread_mutex_lock(&service_lock);
+        wait_pagefile_reads(); // pages read ahead for an advice must be present
+        settle_evicted();
+        if(vmem->adm.req_advice == VOID_IDX) {
+            allocate_page();
+            PRINT_DEBUG((stderr, "Processed page fault\n"));
+        }
+        else if(vmem->adm.req_advice == VMEM_REQ_LOCK || vmem->adm.req_advice == VMEM_REQ_UNLOCK) {
+            lock_pages();
+            PRINT_DEBUG((stderr, "Processed lock request\n"));
+        }
+        else {
+            advise_pages();
+            PRINT_DEBUG((stderr, "Processed advice %d\n", vmem->adm.req_advice));
+        }
+        fault_complete(&vmem->adm);
+        if(free_high > 0 && vmem->adm.nfree <= free_low) {
+            pthread_mutex_lock(&clean_lock);
+            clean_pending = TRUE;
+            pthread_cond_signal(&clean_wakeup);
+            pthread_mutex_unlock(&clean_lock);
+        }
+        pthread_mutex_unlock(&service_lock);
+    }
+    return NULL;
+}
+
+void *page_cleaner(void *arg) {
+    struct timespec deadline;
+    int scanned;
+    int written;
+    int pending;
+    (void) arg;
+
+    while(1) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += MMANAGE_CLEAN_INTERVAL_MS * 1000000L;
+        if(deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&clean_lock);
+        while(!clean_pending && pthread_cond_timedwait(&clean_wakeup, &clean_lock, &deadline) != ETIMEDOUT) {
+            ; // woken up spuriously
+        }
+        pending = clean_pending;
+        clean_pending = FALSE;
+        pthread_mutex_unlock(&clean_lock);
+
+        if(pending && clean_evicts) {
+            while(1) {
+                pthread_mutex_lock(&service_lock);
+                if(vmem->adm.nfree >= free_high || vmem->adm.nfree + vmem->adm.nlocked >= vmem->adm.nframes) {
+                    pthread_mutex_unlock(&service_lock);
+                    break;
+                }
+                evict_page();
+                pthread_mutex_unlock(&service_lock);
+            }
+            continue;
+        }
+
+        written = 0;
+        // vmem is only used under service_lock, cleanup detaches it while holding the lock
+        for(scanned = 0; scanned < nframes && written < free_high; scanned++) {
+            int frame;
+            int page;
+            pthread_mutex_lock(&service_lock);
+            frame = clean_hand;
+            page = pt.framepage[frame];
+            clean_hand = (frame + 1) % vmem->adm.nframes;
+            // locked pages too: they are clean when they are unlocked and replaced
+            if(page != VOID_IDX && clear_dirty(page)) {
+                store_page(frame);
+                clean_writes++;
+                written++;
+            }
+            pthread_mutex_unlock(&service_lock);
+        }
+    }
+    return NULL;
+}
+
+void evict_page(void) {
+    int frame;
+    int page;
+
+    wait_pagefile_reads(); // the frame of a page read for an advice is written until the read completes
+    frame = pagerep_evict(&vmem->adm, &pt, VOID_IDX);
+    page = pt.framepage[frame];
+    if(clear_dirty(page)) {
+        store_page(frame);
+        clean_writes++;
+    }
+    pagerep_free_frame(&vmem->adm, &pt, frame);
+    evicted[nevicted++] = page;
+    clean_count++;
+}
+
+void settle_evicted(void) {
+    int i;
+
+    for(i = 0; i < nevicted; i++) {
+        int page = evicted[i];
+        int frame = pt.entries[page].frame;
+        if(clear_dirty(page)) {
+            vmem->adm.wb_count++;
+            clean_writes++;
+            store_page_to_pagefile(page, &vmem_data[frame * vmem->adm.pagesize]);
+        }
+        pt.framegen[frame]++;
+    }
+    nevicted = 0;
+}
+
+void wait_for_signals(void) {
+    sigset_t sigs;
+    int signo;
+
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGUSR2);
+    sigaddset(&sigs, SIGINT);
+    while(1) {
+        TEST_AND_EXIT(sigwait(&sigs, &signo) != 0, (stderr, "Error waiting for signals\n"));
+        pthread_mutex_lock(&service_lock);
+        if(signo == SIGINT) {
+            // keep service_lock, the fault service must not touch the page table any more
+            return;
+        }
         dump_pt();
-    } else if(signo == SIGINT) {
-        cleanup();
-        exit(EXIT_SUCCESS);
-    }  
+        pthread_mutex_unlock(&service_lock);
+    }
 }
 
 /* Your code goes here... */
@@ -310,150 +724,315 @@ void sighandler(int signo) {
 void vmem_init(void) {
 		key_t key;
 		int shmid;
+		struct vmem_adm_struct layout;
+		size_t shmsize = vmem_layout(&layout, pagesize, virtmemsize / pagesize, nframes);
+
 		key = ftok(SHMKEY, SHMPROCID);
 		TEST_AND_EXIT_ERRNO(key == -1,"ftok: ftok failed");
 
-		shmid = shmget(key, SHMSIZE, 0666 | IPC_CREAT);
+		// remove a segment left over by a previous run, it may have another size
+		shmid = shmget(key, 0, 0666);
+		if(shmid >= 0) {
+			shmctl(shmid, IPC_RMID, NULL);
+		}
+		shmid = shmget(key, shmsize, 0666 | IPC_CREAT | IPC_EXCL);
 		TEST_AND_EXIT_ERRNO(shmid < 0, "shmget: shmget failed");
 
 		vmem = (struct vmem_struct*)shmat(shmid, NULL, 0);
-		TEST_AND_EXIT_ERRNO(vmem == NULL, "shmat: shmat failed");
-
-		local_sem = sem_open(NAMED_SEM, O_CREAT, 0644, 1);
-		TEST_AND_EXIT_ERRNO(local_sem == NULL, "sem_init:sem_init failed");
-
-//		//physikalischer speicher
-//	    int data[VMEM_NFRAMES * VMEM_PAGESIZE];  //!< main memory used by virtual memory simulation
-//
-//	    //page table
-	    int i;
-	    for(i = 0; i < VMEM_NPAGES; i++) {
-	    	vmem->pt.entries[i].flags = 0;
-	    	vmem->pt.entries[i].frame = VOID_IDX;
-	    	vmem->pt.entries[i].age = 0;
-	    }
-	    int j;
-	    for(j = 0; j < VMEM_NFRAMES; j++) {
-	    	vmem->pt.framepage[j] = VOID_IDX;
-	    }
+		TEST_AND_EXIT_ERRNO(vmem == (struct vmem_struct *) -1, "shmat: shmat failed");
+
+		vmem->adm = layout;
+		vmem_data = vmem_map(vmem, &pt);
+
+	    //page table, pagerep_init needs the policy
+		vmem->adm.page_rep_algo = page_rep_algo;
+	    pagerep_init(&vmem->adm, &pt);
 
 	    //admin data
-		vmem->adm.size = VMEM_VIRTMEMSIZE;
 		vmem->adm.mmanage_pid = getpid();
 		vmem->adm.g_count = 0;
 		vmem->adm.pf_count = 0;
-		vmem->adm.req_pageno = -1;
-		vmem->adm.shm_id = 0;
-		vmem->adm.page_rep_algo = VMEM_ALGO_FIFO;
-		vmem->adm.next_alloc_idx = 0;
+		vmem->adm.wb_count = 0;
+		vmem->adm.ra_count = 0;
+		vmem->adm.ra_useful = 0;
+		vmem->adm.ra_wasted = 0;
+		vmem->adm.tlb_hits = 0;
+		vmem->adm.tlb_misses = 0;
+		fault_init(&vmem->adm);
+		vmem->adm.shm_id = shmid;
+		vmem->adm.ws_tau = ws_tau;
+		vmem->adm.program_name = program_name;
+		vmem->adm.writeback = writeback_page;
+		vmem->adm.writeback_ctx = NULL;
 
 		replacedFrame = VOID_IDX;
+		page_advice = calloc(vmem->adm.npages, sizeof(unsigned char)); // all VMEM_ADV_NORMAL
+		TEST_AND_EXIT_ERRNO(page_advice == NULL, "calloc: page advice");
+		// the cleaner must not evict while the application updates the policy state
+		clean_evicts = free_high > 0 && (pagerep_policy(&vmem->adm)->flags & PAGEREP_NEEDS_ACCESS) == 0;
+		evicted = malloc(vmem->adm.nframes * sizeof(int));
+		TEST_AND_EXIT_ERRNO(evicted == NULL, "malloc: evicted pages");
 	    //virtual memory
 }
 
-int find_free_frame() {
-	int i;
-	for(i = 0; i < VMEM_NFRAMES; i++) {
-			if(vmem->pt.framepage[i] == VOID_IDX) {
-				return i;
-			}
-		}
-	return -1;
-}
-
 void allocate_page(void) {
 
-	int freeFrameIdx = find_free_frame();
-	if(freeFrameIdx == -1) {
-		freeFrameIdx = find_remove_frame();
-		replacedFrame = vmem->pt.framepage[freeFrameIdx];
-		vmem->pt.entries[replacedFrame].flags &= ~PTF_PRESENT;
-		if((vmem->pt.entries[vmem->pt.framepage[freeFrameIdx]].flags & PTF_DIRTY) == PTF_DIRTY) {
+	int replaced;
+	int freeFrameIdx;
+	int nra;
+
+	if(pt.entries[vmem->adm.req_pageno].flags & PTF_PRESENT) {
+		// read in for an advice while the application was running
+		if(pt.entries[vmem->adm.req_pageno].flags & PTF_PREFETCH) {
+			pt.entries[vmem->adm.req_pageno].flags &= ~PTF_PREFETCH;
+			vmem->adm.ra_useful++;
+		}
+		replacedFrame = VOID_IDX; // no page was replaced for this fault
+		dump_pt();
+		return;
+	}
+	nra = readahead_window(vmem->adm.req_pageno);
+	clean_frames(nra > 0 ? nra + 1 : 0, vmem->adm.req_pageno);
+	freeFrameIdx = pagerep_alloc_frame(&vmem->adm, &pt, vmem->adm.req_pageno, &replaced);
+	replacedFrame = replaced;
+	if(replaced != VOID_IDX) {
+		if(clear_dirty(replaced)) {
 			store_page(freeFrameIdx);
-			vmem->pt.entries[vmem->pt.framepage[freeFrameIdx]].flags &= ~PTF_DIRTY;
 		}
 	}
-	update_pt(freeFrameIdx);
+	pagerep_map_page(&vmem->adm, &pt, vmem->adm.req_pageno, freeFrameIdx);
 	fetch_page(vmem->adm.req_pageno);
+	if(nra > 0) {
+		prefetch_pages(vmem->adm.req_pageno + 1, vmem->adm.req_pageno + ra_window, FALSE);
+		ra_next = vmem->adm.req_pageno + ra_window + 1;
+	}
 	dump_pt();
-	sem_post(local_sem);
 }
 
-void fetch_page(int pt_idx) {
-	int *frameStart = &vmem->data[vmem->pt.entries[pt_idx].frame * VMEM_PAGESIZE];
-	fetch_page_from_pagefile(pt_idx, frameStart);
+void advise_pages(void) {
+	int first = vmem->adm.req_pageno;
+	int last = first + vmem->adm.req_npages - 1;
+	int p;
+	int n;
+
+	switch(vmem->adm.req_advice) {
+		case VMEM_ADV_NORMAL:
+		case VMEM_ADV_RANDOM:
+		case VMEM_ADV_SEQUENTIAL:
+			for(p = first; p <= last; p++) {
+				page_advice[p] = vmem->adm.req_advice;
+			}
+			break;
+		case VMEM_ADV_WILLNEED:
+			// a range larger than memory evicts its own first pages, read in what fits
+			n = absent_pages(first, last);
+			clean_frames(n < vmem->adm.nframes ? n : vmem->adm.nframes, VOID_IDX);
+			prefetch_pages(first, last, TRUE);
+			break;
+		case VMEM_ADV_DONTNEED:
+			for(p = first; p <= last; p++) {
+				if((pt.entries[p].flags & PTF_PRESENT) == 0) {
+					continue;
+				}
+				if(clear_dirty(p)) {
+					store_page(pt.entries[p].frame);
+				}
+				pagerep_demote(&vmem->adm, &pt, p);
+			}
+			break;
+		default:
+			break;
+	}
 }
 
-void store_page(int pt_idx) {
-	store_page_to_pagefile(vmem->pt.framepage[pt_idx], &vmem->data[pt_idx * VMEM_PAGESIZE]);
+void lock_pages(void) {
+	int first = vmem->adm.req_pageno;
+	int last = first + vmem->adm.req_npages - 1;
+	int p;
+	int n = 0;
+
+	if(vmem->adm.req_advice == VMEM_REQ_UNLOCK) {
+		for(p = first; p <= last; p++) {
+			pagerep_pin(&vmem->adm, &pt, p, FALSE);
+		}
+		return;
+	}
+	for(p = first; p <= last; p++) {
+		if((pt.entries[p].flags & PTF_LOCKED) == 0) {
+			n++;
+		}
+	}
+	if(vmem->adm.nlocked + n > lock_max) {
+		vmem->adm.req_result = VOID_IDX;
+		lock_refused++;
+		return;
+	}
+	// lock the present pages first, so making room for the others does not evict them
+	for(p = first; p <= last; p++) {
+		if(pt.entries[p].flags & PTF_PRESENT) {
+			pagerep_pin(&vmem->adm, &pt, p, TRUE);
+		}
+	}
+	clean_frames(absent_pages(first, last), VOID_IDX);
+	for(p = first; p <= last; p++) {
+		if((pt.entries[p].flags & PTF_PRESENT) == 0) {
+			pagerep_map_page(&vmem->adm, &pt, p, find_free_frame(&vmem->adm, &pt));
+			fetch_page(p);
+			pagerep_pin(&vmem->adm, &pt, p, TRUE);
+		}
+	}
+	if(vmem->adm.nlocked > lock_peak) {
+		lock_peak = vmem->adm.nlocked;
+	}
 }
 
-void update_pt(int frame) {
-	int pt_idx = vmem->adm.req_pageno;
-	vmem->pt.entries[pt_idx].frame = frame;
-	vmem->pt.entries[pt_idx].flags |= PTF_PRESENT;
-	vmem->pt.entries[pt_idx].age = 128;
-	vmem->pt.framepage[frame] = pt_idx;
+void clean_frames(int need, int page) {
+	int frame;
+
+	if(!clean_evicts && vmem->adm.nfree < free_low && need < free_high) {
+		need = free_high;
+	}
+	while(vmem->adm.nfree < need && vmem->adm.nfree + vmem->adm.nlocked < vmem->adm.nframes) {
+		frame = pagerep_evict(&vmem->adm, &pt, page);
+		if(clear_dirty(pt.framepage[frame])) {
+			store_page(frame);
+		}
+		pagerep_free_frame(&vmem->adm, &pt, frame);
+		clean_count++;
+	}
 }
 
-int find_remove_frame(void) {
-	int frameToRemove;
-	if(vmem->adm.page_rep_algo == VMEM_ALGO_FIFO) {
-		frameToRemove = find_remove_fifo();
+int readahead_window(int page) {
+	if(page_advice[page] == VMEM_ADV_RANDOM) {
+		ra_window = 0;
+	}
+	else if(page_advice[page] == VMEM_ADV_SEQUENTIAL) {
+		ra_window = (ra_max > 0) ? ra_max : MMANAGE_SEQ_WINDOW;
+		if(ra_window >= vmem->adm.nframes) {
+			ra_window = vmem->adm.nframes - 1;
+		}
 	}
-	else if(vmem->adm.page_rep_algo == VMEM_ALGO_CLOCK) {
-		frameToRemove = find_remove_clock();
+	else if(ra_max == 0) {
+		ra_window = 0;
+	}
+	else if(page == ra_last + 1 || page == ra_next) {
+		if(vmem->adm.ra_wasted > ra_wasted_seen) {
+			ra_window = (ra_window > 1) ? ra_window / 2 : 1;
+		}
+		else {
+			ra_window = (ra_window > 0) ? ra_window * 2 : 1;
+			if(ra_window > ra_max) {
+				ra_window = ra_max;
+			}
+		}
 	}
 	else {
-		frameToRemove = find_remove_aging();
+		ra_window = 0;
 	}
-	return frameToRemove;
+	ra_wasted_seen = vmem->adm.ra_wasted;
+	ra_last = page;
+	return absent_pages(page + 1, page + ra_window);
 }
 
-int find_remove_fifo(void) {
-	int res = vmem->adm.next_alloc_idx;
-	vmem->adm.next_alloc_idx = (vmem->adm.next_alloc_idx + 1) % VMEM_NFRAMES;
-	return res;
-}
+int absent_pages(int first, int last) {
+	int n = 0;
+	int p;
 
-int find_remove_clock(void) {
-	int virtualPageIdx = vmem->pt.framepage[vmem->adm.next_alloc_idx];
-	while((vmem->pt.entries[virtualPageIdx].flags & PTF_REF) == PTF_REF) {
-		vmem->pt.entries[virtualPageIdx].flags &= ~PTF_REF; //set reference bit 0
-		vmem->adm.next_alloc_idx = (vmem->adm.next_alloc_idx + 1) % VMEM_NFRAMES;
-		virtualPageIdx = vmem->pt.framepage[vmem->adm.next_alloc_idx];
+	for(p = first; p <= last && p < vmem->adm.npages; p++) {
+		if((pt.entries[p].flags & PTF_PRESENT) == 0) {
+			n++;
+		}
 	}
-	int result = vmem->pt.entries[virtualPageIdx].frame;
-	vmem->adm.next_alloc_idx = (vmem->adm.next_alloc_idx + 1) % VMEM_NFRAMES;
-	return result;
+	return n;
 }
 
-int find_remove_aging(void) {
-	int res = vmem->pt.framepage[0];
-	int i = 0;
-	for(i = 1; i < VMEM_NFRAMES; i++) {
-		int virtualPageIdx = vmem->pt.framepage[i];
-		if(vmem->pt.entries[virtualPageIdx].age <= vmem->pt.entries[res].age) {
-			res = virtualPageIdx;
+void prefetch_pages(int first, int last, int async) {
+	int p;
+
+	for(p = first; p <= last && p < vmem->adm.npages && vmem->adm.nfree > 0; p++) {
+		if((pt.entries[p].flags & PTF_PRESENT) == 0) {
+			pagerep_map_prefetch(&vmem->adm, &pt, p, find_free_frame(&vmem->adm, &pt));
+			if(async) {
+				// the application waits for the request, it does not see the page present yet
+				pt.entries[p].flags &= ~PTF_PRESENT;
+				fetch_page_from_pagefile_async(p, &vmem_data[pt.entries[p].frame * vmem->adm.pagesize],
+				                               publish_page);
+			}
+			else {
+				fetch_page(p);
+			}
 		}
 	}
-	return vmem->pt.entries[res].frame;
+}
+
+void publish_page(int pt_idx) {
+	__atomic_fetch_or(&pt.entries[pt_idx].flags, PTF_PRESENT, __ATOMIC_RELEASE);
+}
+
+void fetch_page(int pt_idx) {
+	int *frameStart = &vmem_data[pt.entries[pt_idx].frame * vmem->adm.pagesize];
+	fetch_page_from_pagefile(pt_idx, frameStart);
+}
+
+void store_page(int frame) {
+	vmem->adm.wb_count++;
+	store_page_to_pagefile(pt.framepage[frame], &vmem_data[frame * vmem->adm.pagesize]);
+}
+
+int clear_dirty(int page) {
+	return (__atomic_fetch_and(&pt.entries[page].flags, ~PTF_DIRTY, __ATOMIC_ACQ_REL) & PTF_DIRTY) != 0;
+}
+
+void writeback_page(void *ctx, int frame) {
+	(void) ctx;
+	store_page(frame);
 }
 
 void cleanup(void) {
-	TEST_AND_EXIT_ERRNO(sem_destroy(local_sem) == -1, "Semaphor konnte nicht zerstoert werden");
+	dump_stats();
+	cleanup_pagefile();
+	close_logger();
+	int shmid = vmem->adm.shm_id;
 	shmdt(vmem);
-	shmctl(SHMPROCID, IPC_RMID, NULL);
+	shmctl(shmid, IPC_RMID, NULL);
+	free(page_advice);
+	free(evicted);
 }
 
 void dump_pt(void) {
 	struct logevent logEvent;
-	logEvent.alloc_frame = vmem->pt.entries[vmem->adm.req_pageno].frame; //die physikalische Seite die allokiert wurde
+	logEvent.alloc_frame = pt.entries[vmem->adm.req_pageno].frame; //die physikalische Seite die allokiert wurde
 	logEvent.g_count = vmem->adm.g_count; //global-count
 	logEvent.pf_count = vmem->adm.pf_count; //page fault count
+	logEvent.wb_count = vmem->adm.wb_count; //writeback count
+	logEvent.ra_useful = vmem->adm.ra_useful; //read ahead pages referenced
+	logEvent.ra_wasted = vmem->adm.ra_wasted; //read ahead pages evicted unused
 	logEvent.replaced_page = replacedFrame; //welche virtuelle seite wurde geloescht
 	logEvent.req_pageno = vmem->adm.req_pageno; //die virtuelle seite die geladen werden sollte
 
 	logger(logEvent);
 }
+void dump_stats(void) {
+	int accesses = vmem->adm.tlb_hits + vmem->adm.tlb_misses;
+	fprintf(stderr, "Page faults: %10d, Global count: %10d, Writebacks: %10d\n",
+			vmem->adm.pf_count, vmem->adm.g_count, vmem->adm.wb_count);
+	fprintf(stderr, "TLB hits:    %10d, TLB misses:   %10d, TLB hit rate: %6.2f%%\n",
+			vmem->adm.tlb_hits, vmem->adm.tlb_misses,
+			accesses ? 100.0 * vmem->adm.tlb_hits / accesses : 0.0);
+	if(vmem->adm.ra_count > 0) {
+		fprintf(stderr, "Read-ahead: %d pages, %d useful, %d wasted\n",
+				vmem->adm.ra_count, vmem->adm.ra_useful, vmem->adm.ra_wasted);
+	}
+	if(lock_peak > 0 || lock_refused > 0) {
+		fprintf(stderr, "Locked: up to %d pages of %d, %d requests refused\n", lock_peak, lock_max, lock_refused);
+	}
+	if(free_high > 0) {
+		fprintf(stderr, "Cleaner: %d pages evicted, %d written back, free frames %d .. %d\n", 
+				clean_count, clean_writes, free_low, free_high);
+	}
+	if(pagerep_policy(&vmem->adm)->stats != NULL) {
+		pagerep_policy(&vmem->adm)->stats(&vmem->adm, stderr);
+	}
+	fflush(stderr);
+}
 // EOF
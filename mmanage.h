@@ -8,5 +8,7 @@
 #ifndef MMANAGE_H
 #define MMANAGE_H
 
+#define MMANAGE_SEQ_WINDOW 8 //!< Read-ahead window of pages advised sequential, if -readahead is off
+#define MMANAGE_CLEAN_INTERVAL_MS 10 //!< The cleaner thread writes dirty pages back at least this often
 
 #endif /* MMANAGE_H */
@@ -7,10 +7,32 @@
   * pages from the pagefile.
   * It is based on an implementation of Wolfgang Fohl, HAW Hamburg.
   *
+  * Two backends are supported: pio (pread / pwrite) and mmap, which
+  * maps the pagefile and copies pages with memcpy.
+  *
+  * Pages are stored by a pool of I/O threads. store_page_to_pagefile
+  * copies the page into a bounce buffer and queues it, so the frame 
+  * can be reused at once and the fetch of the next page overlaps the
+  * writeback. There is at most one queued write per page. A fetch of
+  * a page whose write is still queued copies the bounce buffer.
+  * The I/O threads also read pages for fetch_page_from_pagefile_async,
+  * before any queued write. The caller is told by a callback when a 
+  * page has been read.
+  *
+  * The initial contents of the pagefile are the bytes rand() % 256 
+  * after srand(SEED_PF). They are not written at startup. A page is
+  * generated when it is fetched before it has ever been stored; only
+  * stored pages are materialised in the pagefile. To generate a page
+  * the generator jumps to the page's position in the rand() sequence.
+  * This reproduces the TYPE_3 additive feedback generator of glibc:
+  *    r[i] = r[i-31] + r[i-3] (mod 2^32), rand() = r[i] >> 1
   */
 
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/mman.h>
 #include "debug.h"
 #include "vmem.h"
 #include "pagefile.h"
@@ -18,49 +40,450 @@
 #define MMANAGE_PFNAME "./pagefile.bin" //!< Pagefile name 
 #define SEED_PF        070514           //!< Get reproducable pseudo-random numbers to init pagefile
 
-static FILE *pagefile = NULL;           //!< Reference to pagefile
+#define PAGEFILE_IO_SLOTS 16 //!< Number of bounce buffers, i.e. maximal number of queued writes
+
+/**
+ * A queued write of a page
+ */
+struct pf_io {
+    int page;       //!< page to write; VOID_IDX: free slot
+    int busy;       //!< TRUE while an I/O thread writes the slot
+    int *buf;       //!< bounce buffer, holds the page
+};
+
+/**
+ * A queued read of a page
+ */
+struct pf_read {
+    int page;                  //!< page to read
+    int *frame_start;          //!< frame that receives the page
+    void (*done)(int pt_idx);  //!< called by the I/O thread when the page has been read
+};
+
+static int pagefile = -1;               //!< File descriptor of pagefile
+static int pf_pagesize = 0;             //!< Size of a page
+static int pf_npages = 0;               //!< Number of pages in pagefile
+static int pf_backend = PAGEFILE_PIO;   //!< Selected backend
+static unsigned char *pf_map = NULL;    //!< Mapping of the pagefile (mmap backend)
+static size_t pf_size = 0;              //!< Size of pagefile in bytes
+static unsigned char *pf_stored = NULL; //!< Bitmap of pages materialised in pagefile
+
+static struct pf_io io_slots[PAGEFILE_IO_SLOTS]; //!< Queued writes
+static int io_queued = 0;               //!< Number of used slots that are not busy
+static int io_used = 0;                 //!< Number of used slots
+static int io_stop = FALSE;             //!< Set by cleanup_pagefile to terminate the I/O threads
+static int io_nthreads = 0;             //!< Number of I/O threads, 0: synchronous writes
+static pthread_t *io_threads = NULL;    //!< The I/O threads
+static pthread_mutex_t io_lock = PTHREAD_MUTEX_INITIALIZER; //!< Protects io_slots and the counters
+static pthread_cond_t io_work = PTHREAD_COND_INITIALIZER;   //!< Signalled when a write is queued
+static pthread_cond_t io_done = PTHREAD_COND_INITIALIZER;   //!< Signalled when a write or read has completed
+static struct pf_read *rd_queue = NULL; //!< Queued reads, a ring of pf_npages entries
+static int rd_head = 0;                 //!< Next queued read
+static int rd_queued = 0;               //!< Number of reads not started
+static int rd_pending = 0;              //!< Number of reads not completed
+static pthread_mutex_t gen_lock = PTHREAD_MUTEX_INITIALIZER; //!< Serializes generate_page, reads run in several threads
+
+#define GEN_DEG 31 //!< Degree of the generator recurrence
+#define GEN_TAP 28 //!< x^31 = x^28 + 1 
+
+static uint32_t gen_base[GEN_DEG];      //!< r[3] .. r[33] after srand(SEED_PF)
+static uint32_t gen_window[GEN_DEG];    //!< the 31 values before position gen_pos
+static size_t gen_pos = (size_t) -1;    //!< rand() call number gen_window precedes
+
+/**
+ *****************************************************************************************
+ *  @brief      This function computes a * b mod (x^31 - x^28 - 1) with coefficients 
+ *              mod 2^32.
+ *
+ *  @param      res Receives the product. May alias a or b.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void gen_polymul(uint32_t *res, const uint32_t *a, const uint32_t *b) {
+    uint32_t prod[2 * GEN_DEG - 1] = { 0 };
+    int i, j;
+
+    for (i = 0; i < GEN_DEG; i++) {
+        for (j = 0; j < GEN_DEG; j++) {
+            prod[i + j] += a[i] * b[j];
+        }
+    }
+    for (i = 2 * GEN_DEG - 2; i >= GEN_DEG; i--) {
+        prod[i - GEN_DEG + GEN_TAP] += prod[i];
+        prod[i - GEN_DEG] += prod[i];
+    }
+    memcpy(res, prod, GEN_DEG * sizeof(uint32_t));
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function positions the generator in front of rand() call pos.
+ *
+ *  r[3 + t] is a linear combination of r[3] .. r[33] whose coefficients are those of 
+ *  x^t mod (x^31 - x^28 - 1). rand() call n returns r[n + 344] >> 1.
+ *
+ *  @param      pos Number of the next rand() call (0 = first call after srand).
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void gen_seek(size_t pos) {
+    uint32_t poly[GEN_DEG] = { 0 };
+    uint32_t sq[GEN_DEG] = { 0 };
+    size_t t = pos + 344 - GEN_DEG - 3; // window starts at r[pos + 313]
+    uint32_t top;
+    int i, k;
+
+    if (pos == gen_pos) return;
+
+    poly[0] = 1;
+    sq[1] = 1;
+    for (; t; t >>= 1) {
+        if (t & 1) gen_polymul(poly, poly, sq);
+        gen_polymul(sq, sq, sq);
+    }
+    for (k = 0; k < GEN_DEG; k++) {
+        uint32_t val = 0;
+        for (i = 0; i < GEN_DEG; i++) {
+            val += poly[i] * gen_base[i];
+        }
+        gen_window[k] = val;
+        // poly = poly * x
+        top = poly[GEN_DEG - 1];
+        memmove(poly + 1, poly, (GEN_DEG - 1) * sizeof(uint32_t));
+        poly[0] = top;
+        poly[GEN_TAP] += top;
+    }
+    gen_pos = pos;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function generates the initial contents of page pt_idx.
+ *
+ *  @param      pt_idx Index of the page.
+ * 
+ *  @param      frame_start Receives the page.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void generate_page(int pt_idx, int *frame_start) {
+    unsigned char *dst = (unsigned char *) frame_start;
+    size_t len = pf_pagesize * sizeof(int);
+    uint32_t tmp[GEN_DEG];
+    size_t i;
+    int head = 0; // gen_window is a ring, head is the oldest value r[i - 31]
+
+    gen_seek((size_t) pt_idx * len);
+    for (i = 0; i < len; i++) {
+        uint32_t r = gen_window[head] + gen_window[(head + GEN_DEG - 3) % GEN_DEG];
+        gen_window[head] = r;
+        head = (head + 1) % GEN_DEG;
+        dst[i] = (r >> 1) % (UCHAR_MAX + 1);
+    }
+    // keep gen_window in order, so the next page can continue without a jump
+    for (i = 0; i < GEN_DEG; i++) {
+        tmp[i] = gen_window[(head + i) % GEN_DEG];
+    }
+    memcpy(gen_window, tmp, sizeof(tmp));
+    gen_pos += len;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sets up the generator state of srand(seed).
+ *
+ *  @param      seed Seed as passed to srand.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void gen_init(unsigned int seed) {
+    int32_t r[GEN_DEG + 3];
+    int i;
+
+    r[0] = (seed == 0) ? 1 : seed;
+    for (i = 1; i < GEN_DEG; i++) {
+        // r[i] = (16807 * r[i - 1]) % 2147483647 without overflow
+        int32_t hi = r[i - 1] / 127773;
+        int32_t lo = r[i - 1] % 127773;
+        r[i] = 16807 * lo - 2836 * hi;
+        if (r[i] < 0) r[i] += 2147483647;
+    }
+    for (i = GEN_DEG; i < GEN_DEG + 3; i++) {
+        r[i] = r[i - GEN_DEG];
+    }
+    for (i = 0; i < GEN_DEG; i++) {
+        gen_base[i] = (uint32_t) r[i + 3];
+    }
+    gen_pos = (size_t) -1;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes a page to its place in the pagefile.
+ *
+ *  It may be called by several threads at once for different pages.
+ *
+ *  @param      pt_idx Index of the page.
+ * 
+ *  @param      frame_start The page.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static void write_page(int pt_idx, const int *frame_start) {
+    size_t len = pf_pagesize * sizeof(int);
+    off_t offset = (off_t) pt_idx * len;
+
+    if (pf_backend == PAGEFILE_MMAP) {
+        memcpy(pf_map + offset, frame_start, len);
+        return;
+    }
+    TEST_AND_EXIT_ERRNO(pwrite(pagefile, frame_start, len, offset) != (ssize_t) len, "Error writing page to disk");
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the slot of the queued write of page pt_idx.
+ *              io_lock must be held.
+ *
+ *  @param      pt_idx Index of the page.
+ *
+ *  @return     The slot or NULL if no write of the page is queued.
+ ****************************************************************************************/
+static struct pf_io *io_find(int pt_idx) {
+    int i;
+    for (i = 0; i < PAGEFILE_IO_SLOTS; i++) {
+        if (io_slots[i].page == pt_idx) return &io_slots[i];
+    }
+    return NULL;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function is an I/O thread. It reads and writes the queued pages.
+ *
+ *  Reads go first, a page read ahead is waited for sooner than a page written back.
+ *  It terminates when io_stop is set and no read or write is queued.
+ *
+ *  @param      arg unused
+ *
+ *  @return     NULL
+ ****************************************************************************************/
+static void *io_worker(void *arg) {
+    struct pf_io *io;
+    int i;
+    (void) arg;
+
+    pthread_mutex_lock(&io_lock);
+    while (1) {
+        while (io_queued == 0 && rd_queued == 0 && !io_stop) {
+            pthread_cond_wait(&io_work, &io_lock);
+        }
+        if (rd_queued > 0) {
+            struct pf_read rd = rd_queue[rd_head];
+            rd_head = (rd_head + 1) % pf_npages;
+            rd_queued--;
+            pthread_mutex_unlock(&io_lock);
 
-void init_pagefile(void) {
+            fetch_page_from_pagefile(rd.page, rd.frame_start);
+            rd.done(rd.page);
+
+            pthread_mutex_lock(&io_lock);
+            rd_pending--;
+            pthread_cond_broadcast(&io_done);
+            continue;
+        }
+        if (io_queued == 0) break;
+        for (i = 0; io_slots[i].page == VOID_IDX || io_slots[i].busy; i++)
+            ;
+        io = &io_slots[i];
+        io->busy = TRUE;
+        io_queued--;
+        pthread_mutex_unlock(&io_lock);
+
+        write_page(io->page, io->buf);
+
+        pthread_mutex_lock(&io_lock);
+        io->busy = FALSE;
+        io->page = VOID_IDX;
+        io_used--;
+        pthread_cond_broadcast(&io_done);
+    }
+    pthread_mutex_unlock(&io_lock);
+    return NULL;
+}
+
+void init_pagefile(int pagesize, int npages, int backend, int advice, int iothreads) {
     int i;
+
+    pf_pagesize = pagesize;
+    pf_npages = npages;
+    pf_backend = backend;
+    pf_size = (size_t) pagesize * npages * sizeof(int);
     /* Always generate a new file. 
        Otherwise: Run into problem if sizes change */
-    pagefile = fopen(MMANAGE_PFNAME, "w+");
-    TEST_AND_EXIT_ERRNO(!pagefile, "Error creating pagefile with w+");
+    pagefile = open(MMANAGE_PFNAME, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    TEST_AND_EXIT_ERRNO(pagefile == -1, "Error creating pagefile");
+
+    gen_init(SEED_PF);
+    pf_stored = calloc((npages + CHAR_BIT - 1) / CHAR_BIT, 1);
+    TEST_AND_EXIT_ERRNO(!pf_stored, "Error allocating pagefile bitmap");
 
-    srand(SEED_PF);
+    // sparse file, pages are materialised when they are stored
+    TEST_AND_EXIT_ERRNO(ftruncate(pagefile, pf_size) == -1, "Error resizing pagefile");
+
+    if (pf_backend == PAGEFILE_MMAP) {
+        pf_map = mmap(NULL, pf_size, PROT_READ | PROT_WRITE, MAP_SHARED, pagefile, 0);
+        TEST_AND_EXIT_ERRNO(pf_map == MAP_FAILED, "Error mapping pagefile");
+        if (advice != PAGEFILE_ADV_NONE) {
+            TEST_AND_EXIT_ERRNO(madvise(pf_map, pf_size, advice) == -1, "madvise on pagefile failed");
+        }
+    }
 
-    for(i = 0; i < (VMEM_PAGESIZE * VMEM_NPAGES * sizeof(int)); i++) {
-        unsigned char rndval = rand() % (UCHAR_MAX + 1);
-        fwrite(&rndval, 1, 1, pagefile);
+    for (i = 0; i < PAGEFILE_IO_SLOTS; i++) {
+        io_slots[i].page = VOID_IDX;
+        io_slots[i].busy = FALSE;
+        io_slots[i].buf = malloc(pf_pagesize * sizeof(int));
+        TEST_AND_EXIT_ERRNO(!io_slots[i].buf, "Error allocating bounce buffer");
+    }
+    io_queued = 0;
+    io_used = 0;
+    io_stop = FALSE;
+    rd_queue = calloc(npages, sizeof(struct pf_read));
+    TEST_AND_EXIT_ERRNO(!rd_queue, "Error allocating read queue");
+    rd_head = 0;
+    rd_queued = 0;
+    rd_pending = 0;
+    io_nthreads = iothreads;
+    io_threads = calloc(iothreads ? iothreads : 1, sizeof(pthread_t));
+    TEST_AND_EXIT_ERRNO(!io_threads, "Error allocating I/O threads");
+    for (i = 0; i < io_nthreads; i++) {
+        TEST_AND_EXIT(pthread_create(&io_threads[i], NULL, io_worker, NULL) != 0,
+                      (stderr, "Error creating I/O thread\n"));
     }
 }
 
 void fetch_page_from_pagefile(int pt_idx, int *frame_start) {
+    struct pf_io *io;
+
     // check page number pt_itx
     TEST_AND_EXIT(pt_idx <  0,           (stderr, "find_page: pt_idx out of range\n"));
-    TEST_AND_EXIT(pt_idx >= VMEM_NPAGES, (stderr, "find_page: pt_idx out of range\n"));
+    TEST_AND_EXIT(pt_idx >= pf_npages, (stderr, "find_page: pt_idx out of range\n"));
     
-    int offset = pt_idx * sizeof(int) * VMEM_PAGESIZE;
+    size_t len = pf_pagesize * sizeof(int);
+    off_t offset = (off_t) pt_idx * len;
 
-    TEST_AND_EXIT_ERRNO(fseek(pagefile, offset, SEEK_SET) == -1, "Positioning in pagefile failed!");
-    TEST_AND_EXIT_ERRNO(fread(frame_start, sizeof(int), VMEM_PAGESIZE, pagefile) != VMEM_PAGESIZE, "Error reading page from disk");
+    if (!(pf_stored[pt_idx / CHAR_BIT] & (1 << (pt_idx % CHAR_BIT)))) {
+        pthread_mutex_lock(&gen_lock);
+        generate_page(pt_idx, frame_start);
+        pthread_mutex_unlock(&gen_lock);
+        return;
+    }
+    // the latest contents may still be in a bounce buffer
+    pthread_mutex_lock(&io_lock);
+    io = io_find(pt_idx);
+    if (io != NULL) {
+        memcpy(frame_start, io->buf, len);
+        pthread_mutex_unlock(&io_lock);
+        return;
+    }
+    pthread_mutex_unlock(&io_lock);
+
+    if (pf_backend == PAGEFILE_MMAP) {
+        memcpy(frame_start, pf_map + offset, len);
+        return;
+    }
+    TEST_AND_EXIT_ERRNO(pread(pagefile, frame_start, len, offset) != (ssize_t) len, "Error reading page from disk");
 }
 
 void store_page_to_pagefile(int pt_idx, int *frame_start) {
+    struct pf_io *io;
+
     // check page number pt_itx
     TEST_AND_EXIT(pt_idx <  0,           (stderr, "store_page: pt_idx out of range\n"));
-    TEST_AND_EXIT(pt_idx >= VMEM_NPAGES, (stderr, "store_page: pt_idx out of range\n"));
+    TEST_AND_EXIT(pt_idx >= pf_npages, (stderr, "store_page: pt_idx out of range\n"));
+
+    pf_stored[pt_idx / CHAR_BIT] |= 1 << (pt_idx % CHAR_BIT);
+    if (io_nthreads == 0) {
+        write_page(pt_idx, frame_start);
+        return;
+    }
+
+    pthread_mutex_lock(&io_lock);
+    // a write of the page that is in progress must complete first, the new one would race with it
+    while ((io = io_find(pt_idx)) != NULL && io->busy) {
+        pthread_cond_wait(&io_done, &io_lock);
+    }
+    if (io == NULL) {
+        while (io_used == PAGEFILE_IO_SLOTS) {
+            pthread_cond_wait(&io_done, &io_lock);
+        }
+        io = io_find(VOID_IDX);
+        io->page = pt_idx;
+        io_used++;
+        io_queued++;
+        pthread_cond_signal(&io_work);
+    }
+    // else: replace the contents of the queued write
+    memcpy(io->buf, frame_start, pf_pagesize * sizeof(int));
+    pthread_mutex_unlock(&io_lock);
+}
 
+void fetch_page_from_pagefile_async(int pt_idx, int *frame_start, void (*done)(int pt_idx)) {
+    struct pf_read *rd;
 
-    int offset = pt_idx * sizeof(int) * VMEM_PAGESIZE;
+    if (io_nthreads == 0) {
+        fetch_page_from_pagefile(pt_idx, frame_start);
+        done(pt_idx);
+        return;
+    }
+    pthread_mutex_lock(&io_lock);
+    TEST_AND_EXIT(rd_pending == pf_npages, (stderr, "fetch_page_async: too many reads queued\n"));
+    rd = &rd_queue[(rd_head + rd_queued) % pf_npages];
+    rd->page = pt_idx;
+    rd->frame_start = frame_start;
+    rd->done = done;
+    rd_queued++;
+    rd_pending++;
+    pthread_cond_signal(&io_work);
+    pthread_mutex_unlock(&io_lock);
+}
 
-    TEST_AND_EXIT_ERRNO(fseek(pagefile, offset, SEEK_SET) == -1, "Positioning in pagefile failed! ");
-    TEST_AND_EXIT_ERRNO(fwrite(frame_start, sizeof(int), VMEM_PAGESIZE, pagefile) != VMEM_PAGESIZE, "Error writing page to disk");
+void wait_pagefile_reads(void) {
+    pthread_mutex_lock(&io_lock);
+    while (rd_pending > 0) {
+        pthread_cond_wait(&io_done, &io_lock);
+    }
+    pthread_mutex_unlock(&io_lock);
 }
 
 
 void cleanup_pagefile(void) {
-    TEST_AND_EXIT_ERRNO(fclose(pagefile) == -1, "fclose in cleanup_pagefile failed! ")
+    int i;
+
+    pthread_mutex_lock(&io_lock);
+    io_stop = TRUE;
+    pthread_cond_broadcast(&io_work);
+    pthread_mutex_unlock(&io_lock);
+    for (i = 0; i < io_nthreads; i++) {
+        pthread_join(io_threads[i], NULL);
+    }
+    free(io_threads);
+    io_threads = NULL;
+    free(rd_queue);
+    rd_queue = NULL;
+    for (i = 0; i < PAGEFILE_IO_SLOTS; i++) {
+        free(io_slots[i].buf);
+        io_slots[i].buf = NULL;
+    }
+
+    if (pf_backend == PAGEFILE_MMAP) {
+        TEST_AND_EXIT_ERRNO(msync(pf_map, pf_size, MS_SYNC) == -1, "msync in cleanup_pagefile failed! ");
+        TEST_AND_EXIT_ERRNO(munmap(pf_map, pf_size) == -1, "munmap in cleanup_pagefile failed! ");
+        pf_map = NULL;
+    }
+    TEST_AND_EXIT_ERRNO(close(pagefile) == -1, "close in cleanup_pagefile failed! ")
+    free(pf_stored);
+    pf_stored = NULL;
 }
 
 // EOF
@@ -8,13 +8,43 @@
 #ifndef PAGEFILE_H
 #define PAGEFILE_H
 
+#include <sys/mman.h>
+
+/**
+ * Pagefile backends
+ */
+#define PAGEFILE_PIO   0  //!< pread / pwrite
+#define PAGEFILE_MMAP  1  //!< pagefile is mapped, pages are copied with memcpy
+
+#define PAGEFILE_IO_THREADS 2 //!< Default number of I/O threads that write and read ahead pages
+
+/**
+ * madvise hints for the mmap backend
+ */
+#define PAGEFILE_ADV_NONE       (-1)               //!< no madvise call
+#define PAGEFILE_ADV_NORMAL     MADV_NORMAL
+#define PAGEFILE_ADV_RANDOM     MADV_RANDOM
+#define PAGEFILE_ADV_SEQUENTIAL MADV_SEQUENTIAL
+#define PAGEFILE_ADV_WILLNEED   MADV_WILLNEED
+
 /**
  *****************************************************************************************
  *  @brief      This function creates and initializes a new pagefile.
  *
+ *  @param      pagesize Size of a page.
+ *
+ *  @param      npages Number of pages stored in the pagefile.
+ *
+ *  @param      backend PAGEFILE_PIO or PAGEFILE_MMAP.
+ *
+ *  @param      advice One of PAGEFILE_ADV_*. Used by the mmap backend only.
+ *
+ *  @param      iothreads Number of I/O threads that write and read ahead pages. 0: pages 
+ *              are written and read synchronously.
+ *
  *  @return     void 
  ****************************************************************************************/
-void init_pagefile(void);
+void init_pagefile(int pagesize, int npages, int backend, int advice, int iothreads);
 
 /**
  *****************************************************************************************
@@ -34,6 +64,9 @@ void fetch_page_from_pagefile(int pt_idx, int *frame_start);
  *****************************************************************************************
  *  @brief      This function writes a page to pagefile.
  *
+ *  The page is copied and queued for an I/O thread, so the frame may be reused when 
+ *  this function returns. If all bounce buffers are in use it waits for a free one.
+ *
  *  @param      pt_idx Index of the page that should be written to pagefile.
  * 
  *  @param      frame_start Starting address of the frame that contains the page.
@@ -42,9 +75,38 @@ void fetch_page_from_pagefile(int pt_idx, int *frame_start);
  ****************************************************************************************/
 void store_page_to_pagefile(int pt_idx, int *frame_start);
 
+/**
+ *****************************************************************************************
+ *  @brief      This function queues the fetch of a page for an I/O thread.
+ *
+ *  The frame must not be used until done has been called. done is called by the I/O 
+ *  thread, or by this function if there are no I/O threads. At most one fetch of a page
+ *  may be queued.
+ *
+ *  @param      pt_idx Index of the page that should be fetched.
+ * 
+ *  @param      frame_start Starting address of frame that should store the page.
+ *
+ *  @param      done Called with pt_idx when the page is in the frame.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void fetch_page_from_pagefile_async(int pt_idx, int *frame_start, void (*done)(int pt_idx));
+
+/**
+ *****************************************************************************************
+ *  @brief      This function waits until all fetches queued by 
+ *              fetch_page_from_pagefile_async have completed.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void wait_pagefile_reads(void);
+
 /**
  *****************************************************************************************
  *  @brief      This function cleans and closes page file module.
+ *              It waits for the queued writes and stops the I/O threads.
+ *              The mmap backend flushes the mapping with msync.
  *
  *  @return     void 
  ****************************************************************************************/
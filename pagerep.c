@@ -0,0 +1,1266 @@
+/**
+ * @file pagerep.c
+ * @brief Page replacement algorithms FIFO, CLOCK, AGING, LRU, ARC and 
+ *        CLOCK-Pro and the page table bookkeeping of a page fault.
+ *
+ * The functions were part of mmanage.c. They are shared by mmanage and
+ * the offline simulator vmsim.
+ *
+ * Aging is done by the memory manager: vmaccess only records in the 
+ * reference bitmap of each accessed frame in which aging intervals the 
+ * frame was referenced (pagerep_age_ref). On a page fault pagerep_age 
+ * shifts the intervals completed since the last fault into the ages, so 
+ * the result equals aging every UPDATE_AGE_COUNT accesses, and the 
+ * application never sweeps the frames or writes an age concurrently to 
+ * mmanage. The shift is lazy: frameage holds the age as of the interval
+ * framebase, later intervals are shifted in when the age of the frame is 
+ * needed (aging_age). The highest bit of an age is the last reference, so
+ * the frames are filed in a bucket per interval of the last reference, 
+ * for the last 8 intervals, and in a bitmap for age 0. A shift moves no 
+ * frame: it only ages out the buckets of the intervals that leave the
+ * last 8 into the bitmap. The victim is the highest frame in the bitmap,
+ * or else the frame of the smallest age in the oldest bucket. A frame 
+ * referenced since it was filed is filed again on the way. A bucket holds
+ * at most the frames referenced or mapped in one interval, so a fault 
+ * costs O(UPDATE_AGE_COUNT) plus a bitmap search and frames that are 
+ * filed again, instead of two passes over all frames.
+ *
+ * Frames may become free while others are in use, when mmanage evicts 
+ * pages ahead of need (pagerep_evict, pagerep_free_frame). The clock 
+ * hands skip free frames, LRU unlinks them and Aging takes them out of
+ * its buckets.
+ * ARC and CLOCK-Pro only see resident pages anyway.
+ * Pages read ahead into free frames are mapped without PTF_REF, so the
+ * clocks pass them over first. LRU appends them as tail, Aging gives 
+ * them age 0 and WSClock puts them outside the working set (on_prefetch).
+ * pagerep_demote does the same for present pages (on_demote).
+ *
+ * Pages locked by the application (PTF_LOCKED) stay in the structures of 
+ * the policies, the victim selection passes over them like over pages 
+ * that are referenced. The clocks skip them, LRU takes the last unlocked 
+ * frame and Aging files them in no bucket, like free frames. CAR moves them from T1 to
+ * T2 and CLOCK-Pro keeps them while they are cold.
+ *
+ * ARC is implemented as CAR (Bansal, Modha: "CAR: Clock with Adaptive 
+ * Replacement", FAST 2004), so it only needs the reference bit that 
+ * vmaccess sets. Resident pages are in the clocks T1 (seen once) and T2
+ * (seen again), evicted pages are remembered in the LRU ghost lists B1 
+ * and B2. A fault on a page in B1 / B2 moves the target size arc_p of T1 
+ * up / down.
+ *
+ * CLOCK-Pro (Jiang, Chen, Zhang: "CLOCK-Pro: An Effective Improvement of
+ * the CLOCK Replacement", USENIX 2005) keeps hot pages, resident cold pages
+ * and non-resident cold pages in their test period on one clock. A fault 
+ * on a page in its test period makes it hot and raises the target number
+ * of cold pages, a test period that ends without one lowers it. The test
+ * hand never runs the cold hand, so a fault evicts exactly one page.
+ *
+ * Both algorithms insert a page unreferenced (PAGEREP_INSERT_UNREF), so 
+ * vmaccess does not set PTF_REF for the access that caused the fault.
+ *
+ * WSClock (Carr, Hennessy: "WSCLOCK - A Simple and Effective Algorithm for
+ * Virtual Memory Management", SOSP 1981) uses g_count as virtual time. The
+ * hand stores the time of last use in pt_entry.count when it clears PTF_REF.
+ * A page unused for more than ws_tau accesses has left the working set: 
+ * if it is clean it is replaced, if it is dirty it is queued for writeback
+ * and the hand moves on. When the victim is evicted, the queue is handed to 
+ * the writeback function of the caller (adm->writeback), before the new 
+ * page is mapped.
+ *
+ * Enhanced second chance sweeps the clock for a page of class (ref 0, 
+ * dirty 0) first and leaves the bits alone. If there is none, it sweeps
+ * for (ref 0, dirty 1) and clears the reference bits on its way, so the
+ * next pair of sweeps is sure to find a victim. Clean victims need no
+ * writeback on the fault path. The sort applications write to nearly every
+ * page they touch, so there are few clean pages to prefer: with 16 frames
+ * of 8 words bubblesort needs 15550 writebacks against 15551 with CLOCK,
+ * with 16 frames of 32 words 366 against 919.
+ */
+
+#include <string.h>
+#include "pagerep.h"
+
+#define ARC_NONE 0  //!< pagestate: page not in any ARC list
+#define ARC_T1   1  //!< pagestate: resident, seen once
+#define ARC_T2   2  //!< pagestate: resident, seen at least twice
+#define ARC_B1   3  //!< pagestate: evicted from T1
+#define ARC_B2   4  //!< pagestate: evicted from T2
+
+#define CP_NONE     0  //!< pagestate: page not on the CLOCK-Pro clock
+#define CP_HOT      1  //!< pagestate: resident hot page
+#define CP_COLD     2  //!< pagestate: resident cold page
+#define CP_TEST     3  //!< pagestate: non-resident cold page in its test period
+#define CP_PROMOTED 4  //!< pagestate: faulted in its test period, becomes hot when mapped
+
+#define AGE_UNFILED (-2) //!< lru link of Aging: frame free or locked, in no bucket
+#define AGE_ZERO    (-3) //!< lru link of Aging: frame in the bitmap of age 0
+
+/**
+ * TRUE if frame holds a page that may be replaced, i.e. it is neither free nor locked
+ */
+#define FRAME_EVICTABLE(pt, frame) ((pt)->framepage[frame] != VOID_IDX && \
+                                    ((pt)->entries[(pt)->framepage[frame]].flags & PTF_LOCKED) == 0)
+
+/**
+ * Clears flags of a page table entry atomically and returns the old flags. The 
+ * application sets PTF_REF and PTF_DIRTY while the cleaner thread of mmanage 
+ * evicts pages.
+ */
+#define PTE_CLEAR(e, f) __atomic_fetch_and(&(e)->flags, ~(f), __ATOMIC_RELAXED)
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+/**
+ *****************************************************************************************
+ *  @brief      This function appends a page at the tail of a circular page list, i.e.
+ *              just before the head.
+ *
+ *  @param      l The list.
+ *
+ *  @param      link Links of all pages.
+ *
+ *  @param      page The page.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void page_list_append(struct page_list *l, struct lru_link *link, int page) {
+	if(l->head == VOID_IDX) {
+		link[page].prev = page;
+		link[page].next = page;
+		l->head = page;
+	}
+	else {
+		int tail = link[l->head].prev;
+		link[page].prev = tail;
+		link[page].next = l->head;
+		link[tail].next = page;
+		link[l->head].prev = page;
+	}
+	l->size++;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function removes a page from a circular page list. If it was the 
+ *              head, its successor becomes the head.
+ *
+ *  @param      l The list.
+ *
+ *  @param      link Links of all pages.
+ *
+ *  @param      page The page.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void page_list_remove(struct page_list *l, struct lru_link *link, int page) {
+	if(link[page].next == page) {
+		l->head = VOID_IDX;
+	}
+	else {
+		link[link[page].prev].next = link[page].next;
+		link[link[page].next].prev = link[page].prev;
+		if(l->head == page) {
+			l->head = link[page].next;
+		}
+	}
+	l->size--;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      These functions call an optional hook of the selected policy. They test
+ *              the bit of the hook in adm->pagerep_hooks first, so a hook the policy 
+ *              does not have costs neither a load from the policy table nor a call.
+ ****************************************************************************************/
+static inline void hook_fault(struct vmem_adm_struct *adm, struct pt_struct *pt, int page) {
+	if(adm->pagerep_hooks & PAGEREP_HOOK_FAULT) {
+		pagerep_policy(adm)->on_fault(adm, pt, page);
+	}
+}
+
+static inline void hook_evict(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	if(adm->pagerep_hooks & PAGEREP_HOOK_EVICT) {
+		pagerep_policy(adm)->on_evict(adm, pt, page, frame);
+	}
+}
+
+static inline void hook_map(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	if(adm->pagerep_hooks & PAGEREP_HOOK_MAP) {
+		pagerep_policy(adm)->on_map(adm, pt, page, frame);
+	}
+}
+
+static inline void hook_free(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	if(adm->pagerep_hooks & PAGEREP_HOOK_FREE) {
+		pagerep_policy(adm)->on_free(adm, pt, page, frame);
+	}
+}
+
+static inline void hook_prefetch(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	if(adm->pagerep_hooks & PAGEREP_HOOK_PREFETCH) {
+		pagerep_policy(adm)->on_prefetch(adm, pt, page, frame);
+	}
+	else {
+		hook_map(adm, pt, page, frame);
+	}
+}
+
+static inline void hook_demote(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	if(adm->pagerep_hooks & PAGEREP_HOOK_DEMOTE) {
+		pagerep_policy(adm)->on_demote(adm, pt, page, frame);
+	}
+}
+
+static inline void hook_pin(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	if(adm->pagerep_hooks & PAGEREP_HOOK_PIN) {
+		pagerep_policy(adm)->on_pin(adm, pt, page, frame);
+	}
+}
+
+void pagerep_init(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	const struct pagerep_policy *policy = pagerep_policy(adm);
+	int i;
+	for(i = 0; i < adm->npages; i++) {
+		pt->entries[i].flags = 0;
+		pt->entries[i].frame = VOID_IDX;
+		pt->entries[i].count = 0;
+		pt->pagestate[i] = ARC_NONE;
+	}
+	for(i = 0; i < adm->nframes; i++) {
+		pt->framepage[i] = VOID_IDX;
+		pt->framegen[i] = 0;
+	}
+	adm->next_alloc_idx = 0;
+	adm->wb_pending = 0;
+	adm->nfree = adm->nframes;
+	adm->nlocked = 0;
+	for(i = 0; i < adm->nframes; i++) {
+		pt->freeframes[i] = adm->nframes - 1 - i;
+	}
+	adm->pagerep_hooks = (policy->on_fault != NULL ? PAGEREP_HOOK_FAULT : 0) |
+	                     (policy->on_evict != NULL ? PAGEREP_HOOK_EVICT : 0) |
+	                     (policy->on_map != NULL ? PAGEREP_HOOK_MAP : 0) |
+	                     (policy->on_free != NULL ? PAGEREP_HOOK_FREE : 0) |
+	                     (policy->on_prefetch != NULL ? PAGEREP_HOOK_PREFETCH : 0) |
+	                     (policy->on_demote != NULL ? PAGEREP_HOOK_DEMOTE : 0) |
+	                     (policy->on_pin != NULL ? PAGEREP_HOOK_PIN : 0);
+	if(policy->init != NULL) {
+		policy->init(adm, pt);
+	}
+}
+
+int pagerep_find_policy(const char *name) {
+	int i;
+	for(i = 0; i < PAGEREP_NPOLICIES; i++) {
+		if(strcasecmp(name, pagerep_policies[i].name) == 0) {
+			return i;
+		}
+	}
+	return VOID_IDX;
+}
+
+int find_free_frame(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	if(adm->nfree == 0) {
+		return VOID_IDX;
+	}
+	return pt->freeframes[--adm->nfree];
+}
+
+int pagerep_alloc_frame(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int *replaced) {
+	int frame = find_free_frame(adm, pt);
+	*replaced = VOID_IDX;
+	if(frame == VOID_IDX) {
+		frame = pagerep_evict(adm, pt, page);
+		*replaced = pt->framepage[frame];
+	}
+	else {
+		hook_fault(adm, pt, page);
+	}
+	return frame;
+}
+
+int pagerep_evict(struct vmem_adm_struct *adm, struct pt_struct *pt, int page) {
+	struct pt_entry *e;
+	int frame;
+	hook_fault(adm, pt, page);
+	frame = find_remove_frame(adm, pt);
+	hook_evict(adm, pt, pt->framepage[frame], frame);
+	e = &pt->entries[pt->framepage[frame]];
+	if(PTE_CLEAR(e, PTF_PRESENT | PTF_PREFETCH) & PTF_PREFETCH) {
+		adm->ra_wasted++;
+	}
+	pt->framegen[frame]++; // shoot down TLB entries of the replaced page
+	return frame;
+}
+
+void pagerep_free_frame(struct vmem_adm_struct *adm, struct pt_struct *pt, int frame) {
+	hook_free(adm, pt, pt->framepage[frame], frame);
+	pt->framepage[frame] = VOID_IDX;
+	pt->freeframes[adm->nfree++] = frame;
+}
+
+void pagerep_map_page(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	pt->entries[page].frame = frame;
+	pt->entries[page].flags |= PTF_PRESENT;
+	pt->framepage[frame] = page;
+	hook_map(adm, pt, page, frame);
+}
+
+void pagerep_map_prefetch(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	pt->entries[page].frame = frame;
+	pt->entries[page].flags = (pt->entries[page].flags & ~PTF_REF) | PTF_PRESENT | PTF_PREFETCH;
+	pt->framepage[frame] = page;
+	adm->ra_count++;
+	hook_prefetch(adm, pt, page, frame);
+}
+
+void pagerep_demote(struct vmem_adm_struct *adm, struct pt_struct *pt, int page) {
+	PTE_CLEAR(&pt->entries[page], PTF_REF);
+	hook_demote(adm, pt, page, pt->entries[page].frame);
+}
+
+void pagerep_pin(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int lock) {
+	struct pt_entry *e = &pt->entries[page];
+	if(!(e->flags & PTF_LOCKED) == !lock) {
+		return;
+	}
+	if(lock) {
+		e->flags |= PTF_LOCKED;
+		adm->nlocked++;
+	}
+	else {
+		e->flags &= ~PTF_LOCKED;
+		adm->nlocked--;
+	}
+	hook_pin(adm, pt, page, e->frame);
+}
+
+int find_remove_frame(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	return pagerep_policy(adm)->select_victim(adm, pt);
+}
+
+int find_remove_fifo(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int res;
+	do {
+		res = adm->next_alloc_idx;
+		adm->next_alloc_idx = (adm->next_alloc_idx + 1) % adm->nframes;
+	} while(!FRAME_EVICTABLE(pt, res)); // skip free and locked frames
+	return res;
+}
+
+int find_remove_clock(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int virtualPageIdx = pt->framepage[adm->next_alloc_idx];
+	int steps = 0;
+	while(!FRAME_EVICTABLE(pt, adm->next_alloc_idx) || (pt->entries[virtualPageIdx].flags & PTF_REF) == PTF_REF) {
+		if(virtualPageIdx != VOID_IDX) {
+			PTE_CLEAR(&pt->entries[virtualPageIdx], PTF_REF); //set reference bit 0
+		}
+		adm->next_alloc_idx = (adm->next_alloc_idx + 1) % adm->nframes;
+		virtualPageIdx = pt->framepage[adm->next_alloc_idx];
+		if(++steps == adm->nframes) {
+			// after a full turn every reference bit was cleared once, take the next evictable frame
+			while(!FRAME_EVICTABLE(pt, adm->next_alloc_idx)) {
+				adm->next_alloc_idx = (adm->next_alloc_idx + 1) % adm->nframes;
+			}
+			virtualPageIdx = pt->framepage[adm->next_alloc_idx];
+			break;
+		}
+	}
+	int result = pt->entries[virtualPageIdx].frame;
+	adm->next_alloc_idx = (adm->next_alloc_idx + 1) % adm->nframes;
+	return result;
+}
+
+int find_remove_lru(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int frame = adm->lru_tail;
+	while(!FRAME_EVICTABLE(pt, frame)) {
+		frame = pt->lru[frame].prev; // locked
+	}
+	return frame;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function empties the LRU list. Only used frames are linked.
+ ****************************************************************************************/
+static void lru_init(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int i;
+	for(i = 0; i < adm->nframes; i++) {
+		pt->lru[i].prev = VOID_IDX;
+		pt->lru[i].next = VOID_IDX;
+	}
+	adm->lru_head = VOID_IDX;
+	adm->lru_tail = VOID_IDX;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function makes a mapped page the most recently used one.
+ ****************************************************************************************/
+static void lru_map(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	struct lru_link *l = pt->lru;
+	pt->entries[page].count = adm->g_count;
+	if(l[frame].prev == VOID_IDX && adm->lru_head != frame) {
+		// a free frame is not linked, insert it as head
+		l[frame].next = adm->lru_head;
+		if(adm->lru_head != VOID_IDX) {
+			l[adm->lru_head].prev = frame;
+		}
+		else {
+			adm->lru_tail = frame;
+		}
+		adm->lru_head = frame;
+	}
+	else {
+		pagerep_lru_touch(adm, pt, frame);
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function appends a frame that is not linked as tail of the LRU list.
+ ****************************************************************************************/
+static void lru_append(struct vmem_adm_struct *adm, struct pt_struct *pt, int frame) {
+	struct lru_link *l = pt->lru;
+	l[frame].prev = adm->lru_tail;
+	l[frame].next = VOID_IDX;
+	if(adm->lru_tail != VOID_IDX) {
+		l[adm->lru_tail].next = frame;
+	}
+	else {
+		adm->lru_head = frame;
+	}
+	adm->lru_tail = frame;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function makes a page read ahead the least recently used one.
+ ****************************************************************************************/
+static void lru_prefetch(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	pt->entries[page].count = adm->g_count;
+	lru_append(adm, pt, frame); // a free frame is not linked
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function unlinks a frame that becomes free from the LRU list.
+ ****************************************************************************************/
+static void lru_free(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	struct lru_link *l = pt->lru;
+	(void) page;
+	if(l[frame].prev != VOID_IDX) {
+		l[l[frame].prev].next = l[frame].next;
+	}
+	else {
+		adm->lru_head = l[frame].next;
+	}
+	if(l[frame].next != VOID_IDX) {
+		l[l[frame].next].prev = l[frame].prev;
+	}
+	else {
+		adm->lru_tail = l[frame].prev;
+	}
+	l[frame].prev = VOID_IDX;
+	l[frame].next = VOID_IDX;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function makes a page the least recently used one.
+ ****************************************************************************************/
+static void lru_demote(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	lru_free(adm, pt, page, frame);
+	lru_append(adm, pt, frame);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function makes an accessed page the most recently used one.
+ ****************************************************************************************/
+static void lru_access(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame, 
+                       int g_first, int g_last) {
+	(void) g_first;
+	pagerep_lru_touch(adm, pt, frame);
+	pt->entries[page].count = g_last;
+}
+
+int find_remove_arc(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	struct page_list *t1 = &adm->arc_list[ARC_T1 - 1];
+	struct page_list *t2 = &adm->arc_list[ARC_T2 - 1];
+	int t2_locked = 0; // locked pages passed in a row by the hand of T2
+	for(;;) {
+		// T2 may only be empty while frames are free. If it only holds locked pages, 
+		// the page to be replaced is in T1
+		if(t1->size > 0 && (t2->size == 0 || t2_locked >= t2->size || t1->size >= MAX(1, adm->arc_p))) {
+			int page = t1->head;
+			if((pt->entries[page].flags & (PTF_REF | PTF_LOCKED)) == 0) {
+				return pt->entries[page].frame;
+			}
+			page_list_remove(t1, pt->pagelink, page);
+			PTE_CLEAR(&pt->entries[page], PTF_REF); // seen again, move to T2
+			page_list_append(t2, pt->pagelink, page);
+			pt->pagestate[page] = ARC_T2;
+		}
+		else {
+			int page = t2->head;
+			t2_locked = (pt->entries[page].flags & PTF_LOCKED) ? t2_locked + 1 : 0;
+			if((pt->entries[page].flags & (PTF_REF | PTF_LOCKED)) == 0) {
+				return pt->entries[page].frame;
+			}
+			PTE_CLEAR(&pt->entries[page], PTF_REF);
+			t2->head = pt->pagelink[page].next; // advance clock hand of T2
+		}
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function moves the victim, the head of T1 or T2, to the ghost 
+ *              list B1 or B2.
+ ****************************************************************************************/
+static void arc_evict(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	int state = pt->pagestate[page];
+	(void) frame;
+	page_list_remove(&adm->arc_list[state - 1], pt->pagelink, page);
+	state = (state == ARC_T1) ? ARC_B1 : ARC_B2;
+	page_list_append(&adm->arc_list[state - 1], pt->pagelink, page);
+	pt->pagestate[page] = state;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function resets the ARC lists.
+ ****************************************************************************************/
+static void arc_init(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int i;
+	(void) pt;
+	for(i = 0; i < 4; i++) {
+		adm->arc_list[i].head = VOID_IDX;
+		adm->arc_list[i].size = 0;
+	}
+	adm->arc_p = 0;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints the target size and the sizes of the ARC lists.
+ ****************************************************************************************/
+static void arc_stats(struct vmem_adm_struct *adm, FILE *out) {
+	fprintf(out, "ARC: p %d, T1 %d, T2 %d, B1 %d, B2 %d\n", adm->arc_p, 
+	        adm->arc_list[ARC_T1 - 1].size, adm->arc_list[ARC_T2 - 1].size,
+	        adm->arc_list[ARC_B1 - 1].size, adm->arc_list[ARC_B2 - 1].size);
+}
+
+void arc_insert(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	struct page_list *t1 = &adm->arc_list[ARC_T1 - 1];
+	struct page_list *t2 = &adm->arc_list[ARC_T2 - 1];
+	struct page_list *b1 = &adm->arc_list[ARC_B1 - 1];
+	struct page_list *b2 = &adm->arc_list[ARC_B2 - 1];
+	int c = adm->nframes;
+	(void) frame;
+
+	if(pt->pagestate[page] == ARC_B1) {
+		adm->arc_p = MIN(adm->arc_p + MAX(1, b2->size / b1->size), c);
+		page_list_remove(b1, pt->pagelink, page);
+		page_list_append(t2, pt->pagelink, page);
+		pt->pagestate[page] = ARC_T2;
+	}
+	else if(pt->pagestate[page] == ARC_B2) {
+		adm->arc_p = MAX(adm->arc_p - MAX(1, b1->size / b2->size), 0);
+		page_list_remove(b2, pt->pagelink, page);
+		page_list_append(t2, pt->pagelink, page);
+		pt->pagestate[page] = ARC_T2;
+	}
+	else {
+		// keep the directory at c pages per side. The ghost lists are empty 
+		// until the first replacement, so this only happens with all frames used.
+		if(t1->size + b1->size == c) {
+			pt->pagestate[b1->head] = ARC_NONE;
+			page_list_remove(b1, pt->pagelink, b1->head);
+		}
+		else if(t1->size + t2->size + b1->size + b2->size == 2 * c) {
+			pt->pagestate[b2->head] = ARC_NONE;
+			page_list_remove(b2, pt->pagelink, b2->head);
+		}
+		page_list_append(t1, pt->pagelink, page);
+		pt->pagestate[page] = ARC_T1;
+	}
+	PTE_CLEAR(&pt->entries[page], PTF_REF);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function resets the CLOCK-Pro clock. At first all frames may 
+ *              hold cold pages.
+ ****************************************************************************************/
+static void clockpro_init(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	(void) pt;
+	adm->cp_clock.head = VOID_IDX;
+	adm->cp_clock.size = 0;
+	adm->cp_hand_cold = VOID_IDX;
+	adm->cp_hand_test = VOID_IDX;
+	adm->cp_cold_target = adm->nframes;
+	adm->cp_hot = 0;
+	adm->cp_cold = 0;
+	adm->cp_test = 0;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints the sizes of the CLOCK-Pro page classes.
+ ****************************************************************************************/
+static void clockpro_stats(struct vmem_adm_struct *adm, FILE *out) {
+	fprintf(out, "CLOCK-Pro: hot %d, cold %d, test %d, cold target %d\n", 
+	        adm->cp_hot, adm->cp_cold, adm->cp_test, adm->cp_cold_target);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function removes a page from the CLOCK-Pro clock. Hands on the
+ *              page move to its successor.
+ ****************************************************************************************/
+static void clockpro_remove(struct vmem_adm_struct *adm, struct pt_struct *pt, int page) {
+	if(adm->cp_hand_cold == page) {
+		adm->cp_hand_cold = pt->pagelink[page].next;
+	}
+	if(adm->cp_hand_test == page) {
+		adm->cp_hand_test = pt->pagelink[page].next;
+	}
+	page_list_remove(&adm->cp_clock, pt->pagelink, page);
+	if(adm->cp_clock.head == VOID_IDX) {
+		adm->cp_hand_cold = VOID_IDX;
+		adm->cp_hand_test = VOID_IDX;
+	}
+	pt->pagestate[page] = CP_NONE;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function handles a fault on a page in its test period: the page 
+ *              leaves the clock and will come back as hot page. The fault shows that 
+ *              the cold pages are too few, so their target grows.
+ ****************************************************************************************/
+static void clockpro_test_hit(struct vmem_adm_struct *adm, struct pt_struct *pt, int page) {
+	if(pt->pagestate[page] == CP_TEST) {
+		if(adm->cp_cold_target < adm->nframes) {
+			adm->cp_cold_target++;
+		}
+		clockpro_remove(adm, pt, page);
+		adm->cp_test--;
+		pt->pagestate[page] = CP_PROMOTED;
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function moves HAND_test one step. A page whose test period ends 
+ *              without a fault leaves the clock, and the target of cold pages shrinks.
+ ****************************************************************************************/
+static void clockpro_run_hand_test(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int page = adm->cp_hand_test;
+	if(pt->pagestate[page] == CP_TEST) {
+		clockpro_remove(adm, pt, page); // moves the hand to the successor
+		adm->cp_test--;
+		if(adm->cp_cold_target > 1) {
+			adm->cp_cold_target--;
+		}
+	}
+	else {
+		adm->cp_hand_test = pt->pagelink[page].next;
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function moves HAND_hot one step. A hot page that has not been 
+ *              referenced since the last pass becomes cold.
+ ****************************************************************************************/
+static void clockpro_run_hand_hot(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int page;
+	if(adm->cp_clock.head == adm->cp_hand_test) {
+		clockpro_run_hand_test(adm, pt);
+	}
+	page = adm->cp_clock.head;
+	if(pt->pagestate[page] == CP_HOT) {
+		if(pt->entries[page].flags & PTF_REF) {
+			PTE_CLEAR(&pt->entries[page], PTF_REF);
+		}
+		else {
+			pt->pagestate[page] = CP_COLD;
+			adm->cp_hot--;
+			adm->cp_cold++;
+		}
+	}
+	adm->cp_clock.head = pt->pagelink[page].next;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function moves HAND_cold past its page. Then HAND_test and HAND_hot
+ *              run until the test pages and hot pages are within their limits.
+ ****************************************************************************************/
+static void clockpro_advance_hand_cold(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	adm->cp_hand_cold = pt->pagelink[adm->cp_hand_cold].next;
+	while(adm->cp_test > adm->nframes) {
+		clockpro_run_hand_test(adm, pt);
+	}
+	while(adm->cp_hot > adm->nframes - adm->cp_cold_target) {
+		clockpro_run_hand_hot(adm, pt);
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function moves HAND_cold one step. A referenced cold page becomes
+ *              hot. An unreferenced one is the victim, the hand stays on it until it is
+ *              evicted (clockpro_evict).
+ *
+ *  @return     The victim or VOID_IDX.
+ ****************************************************************************************/
+static int clockpro_run_hand_cold(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int page = adm->cp_hand_cold;
+	if(pt->pagestate[page] == CP_COLD && (pt->entries[page].flags & PTF_LOCKED) == 0) {
+		if((pt->entries[page].flags & PTF_REF) == 0) {
+			return page;
+		}
+		PTE_CLEAR(&pt->entries[page], PTF_REF);
+		pt->pagestate[page] = CP_HOT;
+		adm->cp_cold--;
+		adm->cp_hot++;
+	}
+	clockpro_advance_hand_cold(adm, pt);
+	return VOID_IDX;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function evicts the cold page under HAND_cold. It stays on the 
+ *              clock for its test period.
+ ****************************************************************************************/
+static void clockpro_evict(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	(void) frame;
+	pt->pagestate[page] = CP_TEST;
+	adm->cp_cold--;
+	adm->cp_test++;
+	clockpro_advance_hand_cold(adm, pt);
+}
+
+int find_remove_clockpro(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int victim = VOID_IDX;
+	int locked = 0; // locked cold pages passed by HAND_cold
+	while(victim == VOID_IDX) {
+		while(adm->cp_cold == 0 && adm->cp_hot <= adm->nframes - adm->cp_cold_target) {
+			// only while frames are free, the cold hand would not run HAND_hot
+			clockpro_run_hand_hot(adm, pt);
+		}
+		if(locked > adm->cp_cold) {
+			// all cold pages are locked, HAND_hot makes another page cold
+			clockpro_run_hand_hot(adm, pt);
+			locked = 0;
+		}
+		if(pt->pagestate[adm->cp_hand_cold] == CP_COLD && 
+		   (pt->entries[adm->cp_hand_cold].flags & PTF_LOCKED)) {
+			locked++;
+		}
+		victim = clockpro_run_hand_cold(adm, pt);
+	}
+	return pt->entries[victim].frame;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function checks if the faulting page is in its test period.
+ ****************************************************************************************/
+static void clockpro_fault(struct vmem_adm_struct *adm, struct pt_struct *pt, int page) {
+	if(page != VOID_IDX) {
+		clockpro_test_hit(adm, pt, page);
+	}
+}
+
+void clockpro_insert(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	(void) frame;
+	if(pt->pagestate[page] == CP_TEST) {
+		// mapped without a fault, e.g. read ahead: the test period ends without a hit
+		clockpro_remove(adm, pt, page);
+		adm->cp_test--;
+	}
+	if(pt->pagestate[page] == CP_PROMOTED) {
+		pt->pagestate[page] = CP_HOT;
+		adm->cp_hot++;
+	}
+	else {
+		pt->pagestate[page] = CP_COLD;
+		adm->cp_cold++;
+	}
+	// insert at the list head, i.e. just behind HAND_hot
+	if(adm->cp_clock.head == VOID_IDX) {
+		page_list_append(&adm->cp_clock, pt->pagelink, page);
+		adm->cp_hand_cold = page;
+		adm->cp_hand_test = page;
+	}
+	else {
+		if(adm->cp_hand_cold == adm->cp_clock.head) {
+			adm->cp_hand_cold = page;
+		}
+		page_list_append(&adm->cp_clock, pt->pagelink, page);
+	}
+	PTE_CLEAR(&pt->entries[page], PTF_REF);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function queues the page in frame for writeback. The page counts 
+ *              as clean from now on, it is written when the victim is evicted.
+ ****************************************************************************************/
+static void pagerep_schedule_writeback(struct vmem_adm_struct *adm, struct pt_struct *pt, int frame) {
+	pt->wbqueue[adm->wb_pending++] = frame;
+	// acquire: the copy of the page must see the writes that set PTF_DIRTY
+	__atomic_fetch_and(&pt->entries[pt->framepage[frame]].flags, ~PTF_DIRTY, __ATOMIC_ACQ_REL);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes back the pages queued while the victim was 
+ *              searched.
+ ****************************************************************************************/
+static void wsclock_evict(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	int i;
+	(void) page;
+	(void) frame;
+	for(i = 0; i < adm->wb_pending; i++) {
+		adm->writeback(adm->writeback_ctx, pt->wbqueue[i]);
+	}
+	adm->wb_pending = 0;
+}
+
+int find_remove_wsclock(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int scanned;
+	int first_clean = VOID_IDX;
+	int scheduled = FALSE;
+	for(scanned = 0; ; scanned++) {
+		int frame = adm->next_alloc_idx;
+		struct pt_entry *e;
+		if(!FRAME_EVICTABLE(pt, frame)) {
+			adm->next_alloc_idx = (frame + 1) % adm->nframes; // skip free and locked frames
+			continue;
+		}
+		e = &pt->entries[pt->framepage[frame]];
+		if(scanned >= adm->nframes && !scheduled) {
+			// no page outside the working set: take a clean one or the one at the hand
+			if(first_clean != VOID_IDX) {
+				return first_clean;
+			}
+			adm->next_alloc_idx = (frame + 1) % adm->nframes;
+			return frame;
+		}
+		adm->next_alloc_idx = (frame + 1) % adm->nframes;
+		if(e->flags & PTF_REF) {
+			PTE_CLEAR(e, PTF_REF);
+			e->count = adm->g_count;
+		}
+		else if(adm->g_count - e->count > adm->ws_tau) {
+			if((e->flags & PTF_DIRTY) == 0) {
+				return frame;
+			}
+			// the queued pages are clean and old on the next pass of the hand
+			pagerep_schedule_writeback(adm, pt, frame);
+			scheduled = TRUE;
+		}
+		else if(first_clean == VOID_IDX && (e->flags & PTF_DIRTY) == 0) {
+			first_clean = frame;
+		}
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function starts the working set time of a mapped page.
+ ****************************************************************************************/
+static void wsclock_map(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	(void) frame;
+	pt->entries[page].count = adm->g_count;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function puts a page read ahead or demoted outside the working set.
+ ****************************************************************************************/
+static void wsclock_leave_ws(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	(void) frame;
+	pt->entries[page].count = adm->g_count - adm->ws_tau - 1;
+}
+
+int find_remove_esc(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int i;
+	for(;;) {
+		// class (ref 0, dirty 0), the bits stay as they are
+		for(i = 0; i < adm->nframes; i++) {
+			int frame = adm->next_alloc_idx;
+			adm->next_alloc_idx = (frame + 1) % adm->nframes;
+			if(FRAME_EVICTABLE(pt, frame) &&
+			   (pt->entries[pt->framepage[frame]].flags & (PTF_REF | PTF_DIRTY)) == 0) {
+				return frame;
+			}
+		}
+		// class (ref 0, dirty 1), clearing the reference bits
+		for(i = 0; i < adm->nframes; i++) {
+			int frame = adm->next_alloc_idx;
+			struct pt_entry *e;
+			adm->next_alloc_idx = (frame + 1) % adm->nframes;
+			if(!FRAME_EVICTABLE(pt, frame)) {
+				continue;
+			}
+			e = &pt->entries[pt->framepage[frame]];
+			if((e->flags & PTF_REF) == 0) {
+				return frame;
+			}
+			PTE_CLEAR(e, PTF_REF);
+		}
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the aging interval of the last reference that
+ *              is recorded in an age, i.e. of its highest bit.
+ *
+ *  @param      age An age other than 0.
+ *
+ *  @param      now The aging interval the age belongs to.
+ *
+ *  @return     the aging interval of the last reference.
+ ****************************************************************************************/
+static int aging_last_ref(unsigned char age, int now) {
+	return now - (__builtin_clz(age) - 24);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function computes the age of the page in a frame at aging interval 
+ *              now. The intervals after framebase are shifted into the stored age.
+ *
+ *  The bit t % 16 of a reference bitmap is valid if the frame was referenced in the 
+ *  16 intervals up to t + 15, otherwise it is left from an older interval.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      frame The frame.
+ *
+ *  @param      now The aging interval, not before framebase.
+ *
+ *  @return     the age.
+ ****************************************************************************************/
+static unsigned char aging_age(struct pt_struct *pt, int frame, int now) {
+	int base = pt->framebase[frame];
+	int tick = pt->frametick[frame];
+	unsigned char age = (now - base >= 8) ? 0 : pt->frameage[frame] >> (now - base);
+	int t;
+	if(tick <= base) {
+		return age; // not referenced since
+	}
+	for(t = MAX(base + 1, now - 7); t <= now; t++) {
+		if(tick >= t && tick < t + 16 && ((pt->framehist[frame] >> (t & 15)) & 1)) {
+			age |= 128 >> (now - t);
+		}
+	}
+	return age;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      These functions add a frame to and remove it from the bitmap of the
+ *              frames of age 0. A bit of the summary behind the bitmap is set if its
+ *              word of 64 frames is not 0.
+ ****************************************************************************************/
+static void agezero_set(struct vmem_adm_struct *adm, struct pt_struct *pt, int frame) {
+	int nwords = (adm->nframes + 63) / 64;
+	pt->agezero[frame / 64] |= 1ULL << (frame % 64);
+	pt->agezero[nwords + frame / (64 * 64)] |= 1ULL << (frame / 64 % 64);
+}
+
+static void agezero_clear(struct vmem_adm_struct *adm, struct pt_struct *pt, int frame) {
+	int nwords = (adm->nframes + 63) / 64;
+	pt->agezero[frame / 64] &= ~(1ULL << (frame % 64));
+	if(pt->agezero[frame / 64] == 0) {
+		pt->agezero[nwords + frame / (64 * 64)] &= ~(1ULL << (frame / 64 % 64));
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the highest frame in the bitmap of the frames of 
+ *              age 0, VOID_IDX if it is empty.
+ ****************************************************************************************/
+static int agezero_last(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int nwords = (adm->nframes + 63) / 64;
+	int s;
+	for(s = (nwords - 1) / 64; s >= 0; s--) {
+		unsigned long long sum = pt->agezero[nwords + s];
+		if(sum != 0) {
+			int w = s * 64 + 63 - __builtin_clzll(sum);
+			return w * 64 + 63 - __builtin_clzll(pt->agezero[w]);
+		}
+	}
+	return VOID_IDX;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function stores the age of a frame as of age_tick and files an 
+ *              evictable frame under its age: age 0 in the bitmap, others in the 
+ *              bucket of the interval of their last reference.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      frame The frame, not filed.
+ *
+ *  @param      age Its age at age_tick.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void aging_file(struct vmem_adm_struct *adm, struct pt_struct *pt, int frame, unsigned char age) {
+	struct lru_link *l = pt->lru;
+	pt->frameage[frame] = age;
+	pt->framebase[frame] = adm->age_tick;
+	if(!FRAME_EVICTABLE(pt, frame)) {
+		l[frame].prev = l[frame].next = AGE_UNFILED;
+	}
+	else if(age == 0) {
+		l[frame].prev = l[frame].next = AGE_ZERO;
+		agezero_set(adm, pt, frame);
+	}
+	else {
+		int *head = &adm->age_bucket[aging_last_ref(age, adm->age_tick) & 7];
+		l[frame].prev = VOID_IDX;
+		l[frame].next = *head;
+		if(*head != VOID_IDX) {
+			l[*head].prev = frame;
+		}
+		*head = frame;
+	}
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function takes a frame out of its bucket or the bitmap. The stored
+ *              age stays.
+ ****************************************************************************************/
+static void aging_unfile(struct vmem_adm_struct *adm, struct pt_struct *pt, int frame) {
+	struct lru_link *l = pt->lru;
+	if(l[frame].prev == AGE_ZERO) {
+		agezero_clear(adm, pt, frame);
+	}
+	else if(l[frame].prev != AGE_UNFILED) {
+		if(l[frame].prev == VOID_IDX) {
+			adm->age_bucket[aging_last_ref(pt->frameage[frame], pt->framebase[frame]) & 7] = l[frame].next;
+		}
+		else {
+			l[l[frame].prev].next = l[frame].next;
+		}
+		if(l[frame].next != VOID_IDX) {
+			l[l[frame].next].prev = l[frame].prev;
+		}
+	}
+	l[frame].prev = l[frame].next = AGE_UNFILED;
+}
+
+int find_remove_aging(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int now = adm->age_tick;
+	int frame;
+	int t;
+	unsigned char age;
+	// the frame of age 0 with the highest index, once it was not referenced since it was filed
+	while((frame = agezero_last(adm, pt)) != VOID_IDX) {
+		age = aging_age(pt, frame, now);
+		if(age == 0) {
+			return frame;
+		}
+		aging_unfile(adm, pt, frame);
+		aging_file(adm, pt, frame, age);
+	}
+	// else the smallest age is in the bucket of the oldest last reference
+	for(t = now - 7; t <= now; t++) {
+		int victim = VOID_IDX;
+		unsigned char min = 255;
+		frame = adm->age_bucket[t & 7];
+		while(frame != VOID_IDX) {
+			int next = pt->lru[frame].next;
+			age = aging_age(pt, frame, now);
+			if(aging_last_ref(age, now) != t) {
+				// referenced since it was filed, into a later bucket
+				aging_unfile(adm, pt, frame);
+				aging_file(adm, pt, frame, age);
+			}
+			else if(victim == VOID_IDX || age < min || (age == min && frame > victim)) {
+				// on a tie the frame with the highest index is replaced
+				victim = frame;
+				min = age;
+			}
+			frame = next;
+		}
+		if(victim != VOID_IDX) {
+			return victim;
+		}
+	}
+	return VOID_IDX; // not reached, there is an evictable frame
+}
+
+void pagerep_age(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int now = adm->g_count / UPDATE_AGE_COUNT;
+	int t;
+	if(now <= adm->age_tick) {
+		return;
+	}
+	// the buckets of the intervals that leave the last 8 hold ages that became 0
+	for(t = adm->age_tick - 7; t <= MIN(adm->age_tick, now - 8); t++) {
+		int frame = adm->age_bucket[t & 7];
+		while(frame != VOID_IDX) {
+			int next = pt->lru[frame].next;
+			pt->lru[frame].prev = pt->lru[frame].next = AGE_ZERO;
+			agezero_set(adm, pt, frame);
+			frame = next;
+		}
+		adm->age_bucket[t & 7] = VOID_IDX;
+	}
+	adm->age_tick = now;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function advances the aging interval to the one of the fault.
+ ****************************************************************************************/
+static void aging_fault(struct vmem_adm_struct *adm, struct pt_struct *pt, int page) {
+	(void) page;
+	pagerep_age(adm, pt);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function resets the ages and reference bitmaps of all frames and 
+ *              empties the buckets.
+ ****************************************************************************************/
+static void aging_init(struct vmem_adm_struct *adm, struct pt_struct *pt) {
+	int i;
+	for(i = 0; i < adm->nframes; i++) {
+		pt->frameage[i] = 0;
+		pt->framehist[i] = 0;
+		pt->frametick[i] = 0;
+		pt->framebase[i] = 0;
+		pt->lru[i].prev = pt->lru[i].next = AGE_UNFILED;
+	}
+	memset(pt->agezero, 0, AGEZERO_WORDS(adm->nframes) * sizeof(unsigned long long));
+	for(i = 0; i < 8; i++) {
+		adm->age_bucket[i] = VOID_IDX;
+	}
+	adm->age_tick = 0;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function gives a mapped page age 128 and a clean reference bitmap.
+ ****************************************************************************************/
+static void aging_map(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	(void) page;
+	aging_unfile(adm, pt, frame);
+	pt->framehist[frame] = 0;
+	pt->frametick[frame] = 0;
+	aging_file(adm, pt, frame, 128);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function gives a page read ahead or demoted age 0 and a clean 
+ *              reference bitmap.
+ ****************************************************************************************/
+static void aging_demote(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	(void) page;
+	aging_unfile(adm, pt, frame);
+	pt->framehist[frame] = 0;
+	pt->frametick[frame] = 0;
+	aging_file(adm, pt, frame, 0);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function takes a freed frame out of the buckets.
+ ****************************************************************************************/
+static void aging_free(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	(void) page;
+	aging_unfile(adm, pt, frame);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function takes a locked frame out of the buckets and files an 
+ *              unlocked one under its current age.
+ ****************************************************************************************/
+static void aging_pin(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame) {
+	(void) page;
+	aging_unfile(adm, pt, frame);
+	aging_file(adm, pt, frame, aging_age(pt, frame, adm->age_tick));
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function records the aging intervals of a run of accesses.
+ ****************************************************************************************/
+static void aging_access(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame, 
+                         int g_first, int g_last) {
+	(void) adm;
+	(void) page;
+	pagerep_age_ref(pt, frame, g_first, g_last);
+}
+
+const struct pagerep_policy pagerep_policies[PAGEREP_NPOLICIES] = {
+	[VMEM_ALGO_FIFO] = {
+		.name = "fifo", .label = "FIFO", .help = "Fifo page replacement algorithm.",
+		.select_victim = find_remove_fifo,
+	},
+	[VMEM_ALGO_CLOCK] = {
+		.name = "clock", .label = "CLOCK", .help = "Clock page replacement algorithm.",
+		.select_victim = find_remove_clock,
+	},
+	[VMEM_ALGO_AGING] = {
+		.name = "aging", .label = "AGING", .help = "Aging page replacement algorithm.",
+		.flags = PAGEREP_NEEDS_ACCESS,
+		.init = aging_init, .on_fault = aging_fault, .select_victim = find_remove_aging,
+		.on_map = aging_map, .on_free = aging_free, .on_prefetch = aging_demote, 
+		.on_demote = aging_demote, .on_pin = aging_pin, .on_access = aging_access,
+	},
+	[VMEM_ALGO_LRU] = {
+		.name = "lru", .label = "LRU", .help = "LRU page replacement algorithm.",
+		.flags = PAGEREP_NEEDS_ACCESS,
+		.init = lru_init, .select_victim = find_remove_lru, .on_map = lru_map, 
+		.on_free = lru_free, .on_prefetch = lru_prefetch, .on_demote = lru_demote,
+		.on_access = lru_access,
+	},
+	[VMEM_ALGO_ARC] = {
+		.name = "arc", .label = "ARC", .help = "ARC page replacement algorithm (clock based variant CAR).",
+		.flags = PAGEREP_INSERT_UNREF,
+		.init = arc_init, .select_victim = find_remove_arc, .on_evict = arc_evict, .on_map = arc_insert, 
+		.stats = arc_stats,
+	},
+	[VMEM_ALGO_CLOCKPRO] = {
+		.name = "clockpro", .label = "CLOCKPRO", .help = "CLOCK-Pro page replacement algorithm.",
+		.flags = PAGEREP_INSERT_UNREF,
+		.init = clockpro_init, .on_fault = clockpro_fault, .select_victim = find_remove_clockpro,
+		.on_evict = clockpro_evict, .on_map = clockpro_insert,
+		.stats = clockpro_stats,
+	},
+	[VMEM_ALGO_WSCLOCK] = {
+		.name = "wsclock", .label = "WSCLOCK", .help = "WSClock page replacement algorithm.",
+		.select_victim = find_remove_wsclock, .on_evict = wsclock_evict, .on_map = wsclock_map, 
+		.on_prefetch = wsclock_leave_ws,
+		.on_demote = wsclock_leave_ws,
+	},
+	[VMEM_ALGO_ESC] = {
+		.name = "esc", .label = "ESC", .help = "Enhanced second chance page replacement algorithm, prefers clean pages.",
+		.select_victim = find_remove_esc,
+	},
+};
+
+// EOF
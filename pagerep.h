@@ -0,0 +1,483 @@
+/**
+ * @file pagerep.h
+ * @brief Header file of the page replacement module.
+ *
+ * The page replacement algorithms and the page table bookkeeping of a
+ * page fault work on an admin area and a page table. mmanage passes the
+ * ones in shared memory, the offline simulator vmsim passes private copies.
+ *
+ * Each algorithm is a policy in the table pagerep_policies, indexed by 
+ * VMEM_ALGO_*. The table is compiled into every program, so the index in
+ * adm->page_rep_algo selects the same hooks in mmanage and vmaccess.
+ * pagerep_init notes the optional hooks of the policy in adm->pagerep_hooks,
+ * the fault path tests their bits before it calls a hook.
+ */
+
+#ifndef PAGEREP_H
+#define PAGEREP_H
+
+#include "vmem.h"
+
+#define PAGEREP_NPOLICIES 8 //!< Number of policies in pagerep_policies
+
+#define PAGEREP_INSERT_UNREF 1 //!< Policy flag: the access that caused a page fault does not set PTF_REF
+#define PAGEREP_NEEDS_ACCESS 2 //!< Policy flag: on_access must be called for each access
+
+#define PAGEREP_HOOK_FAULT    1  //!< adm->pagerep_hooks: the policy has on_fault
+#define PAGEREP_HOOK_EVICT    2  //!< adm->pagerep_hooks: the policy has on_evict
+#define PAGEREP_HOOK_MAP      4  //!< adm->pagerep_hooks: the policy has on_map
+#define PAGEREP_HOOK_FREE     8  //!< adm->pagerep_hooks: the policy has on_free
+#define PAGEREP_HOOK_PREFETCH 16 //!< adm->pagerep_hooks: the policy has on_prefetch
+#define PAGEREP_HOOK_DEMOTE   32 //!< adm->pagerep_hooks: the policy has on_demote
+#define PAGEREP_HOOK_PIN      64 //!< adm->pagerep_hooks: the policy has on_pin
+
+/**
+ * A page replacement policy. The fault path and the access functions only
+ * call these hooks, optional hooks are NULL if a policy does not need them.
+ */
+struct pagerep_policy {
+    const char *name;  //!< name on the command line, e.g. clock for mmanage -clock and vmsim -algo=clock
+    const char *label; //!< name in reports, e.g. CLOCK
+    const char *help;  //!< one line description for the usage information
+    int flags;         //!< PAGEREP_* policy flags
+
+    //! optional: resets the policy state, after the page table was reset
+    void (*init)(struct vmem_adm_struct *adm, struct pt_struct *pt);
+    //! optional: called before frames are selected, may be called more than once per 
+    //! fault. page is the faulting page, VOID_IDX if frames are freed without a fault
+    void (*on_fault)(struct vmem_adm_struct *adm, struct pt_struct *pt, int page);
+    //! returns the frame whose page should be replaced, free frames and frames of locked
+    //! pages must be skipped. At least one page is neither free nor locked
+    int (*select_victim)(struct vmem_adm_struct *adm, struct pt_struct *pt);
+    //! optional: called for the page in frame that select_victim returned, before it is
+    //! removed from the page table
+    void (*on_evict)(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+    //! optional: called after page was mapped to frame
+    void (*on_map)(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+    //! optional: called when the victim page in frame was evicted and frame becomes free
+    void (*on_free)(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+    //! optional: like on_map for a page read ahead into the free frame, which should be 
+    //! replaced before referenced pages. NULL: on_map is called
+    void (*on_prefetch)(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+    //! optional: makes page in frame one of the first to be replaced, its PTF_REF is clear
+    void (*on_demote)(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+    //! optional: called after PTF_LOCKED of the page in frame was set or cleared
+    void (*on_pin)(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+    //! optional: called by the application for the accesses g_first .. g_last to page in frame,
+    //! only if the policy has flag PAGEREP_NEEDS_ACCESS
+    void (*on_access)(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame, 
+                      int g_first, int g_last);
+    //! optional: prints the policy state, e.g. at the end of a run
+    void (*stats)(struct vmem_adm_struct *adm, FILE *out);
+};
+
+extern const struct pagerep_policy pagerep_policies[PAGEREP_NPOLICIES]; //!< indexed by VMEM_ALGO_*
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the policy selected in the admin data.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @return     The policy.
+ ****************************************************************************************/
+static inline const struct pagerep_policy *pagerep_policy(const struct vmem_adm_struct *adm) {
+    return &pagerep_policies[adm->page_rep_algo];
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function looks up a policy by its name, ignoring case.
+ *
+ *  @param      name The name, e.g. clock.
+ *
+ *  @return     The index of the policy (VMEM_ALGO_*) or VOID_IDX if there is none.
+ ****************************************************************************************/
+int pagerep_find_policy(const char *name);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function resets the page table: no page is present, all frames
+ *              are unused. Then it resets the state of the policy selected in
+ *              adm->page_rep_algo, so this must be set before.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void pagerep_init(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function finds an unused frame.
+ *
+ *  The unused frames are kept on the stack pt->freeframes, so find_free_frame 
+ *  pops one in constant time. At first the smallest frame number is on top, 
+ *  frames freed by pagerep_free_frame are pushed on top.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @return     idx of the unused frame on top of the stack. 
+ *              If all frames are in use, VOID_IDX will be returned.
+ ****************************************************************************************/
+int find_free_frame(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function selects a frame for a page that will be put into memory.
+ *
+ *  If there is no free frame, the page replacement algorithm selects a frame. The page
+ *  stored in this frame is removed from the page table and the generation of the frame 
+ *  is incremented. Its PTF_DIRTY flag is left to the caller, who must write the page 
+ *  back and clear the flag. Other pages the algorithm wants written back are passed 
+ *  to adm->writeback, which must be set if a policy queues writebacks (WSClock).
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      page The faulting page the frame is for.
+ *
+ *  @param      replaced Receives the removed page or VOID_IDX if a free frame was used.
+ *
+ *  @return     idx of the frame.
+ ****************************************************************************************/
+int pagerep_alloc_frame(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int *replaced);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function evicts a page chosen by the page replacement algorithm
+ *              before it is needed, e.g. to keep frames free.
+ *
+ *  It may only be called while a page fault is served, at least one frame must hold
+ *  a page that is not locked. The page is removed from the page table like by pagerep_alloc_frame and stays 
+ *  in pt->framepage, so the caller can write it back. Then the caller must hand the 
+ *  frame to pagerep_free_frame.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      page The faulting page the frame is evicted for, VOID_IDX if the 
+ *              eviction is not caused by a page fault.
+ *
+ *  @return     idx of the frame of the evicted page.
+ ****************************************************************************************/
+int pagerep_evict(struct vmem_adm_struct *adm, struct pt_struct *pt, int page);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function puts a frame emptied by pagerep_evict on the free frame 
+ *              stack.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      frame The frame.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void pagerep_free_frame(struct vmem_adm_struct *adm, struct pt_struct *pt, int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function update the page table for page.
+ *              It will be stored in frame.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      page The now allocated page.
+ *
+ *  @param      frame The frame that stores page.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void pagerep_map_page(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function update the page table for a page that is read ahead.
+ *
+ *  The page gets flag PTF_PREFETCH and no PTF_REF. vmaccess clears PTF_PREFETCH on 
+ *  the first reference, pagerep_evict counts a page evicted with PTF_PREFETCH as 
+ *  wasted.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      page The page read ahead.
+ *
+ *  @param      frame A free frame that stores page.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void pagerep_map_prefetch(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function gives a present page the lowest replacement priority the 
+ *              policy has, e.g. for an advice that it is not needed.
+ *
+ *  PTF_REF is cleared, so clock based policies replace the page at the next pass.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      page The page, it must be present.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void pagerep_demote(struct vmem_adm_struct *adm, struct pt_struct *pt, int page);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function locks a present page in memory, or unlocks it.
+ *
+ *  A locked page has PTF_LOCKED set and is never selected for replacement. 
+ *  adm->nlocked counts the locked pages. Locking a locked page or unlocking a page 
+ *  that is not locked does nothing.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      page The page, it must be present to be locked.
+ *
+ *  @param      lock TRUE: lock the page, FALSE: unlock it.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void pagerep_pin(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int lock);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function selects and starts a page replacement algorithm.
+ *
+ *  It is just a wrapper for select_victim of the selected policy.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @return     The idx of the frame whose page should be replaced.
+ ****************************************************************************************/
+int find_remove_frame(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm fifo.
+ *
+ *  @return     idx of the frame whose page should be replaced.
+ ****************************************************************************************/
+int find_remove_fifo(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm clock.
+ *
+ *  @return     idx of the frame whose page should be replaced.
+ ****************************************************************************************/
+int find_remove_clock(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm aging.
+ *
+ *  If several pages have the smallest age, the one in the frame with the highest 
+ *  frame number is selected.
+ *
+ *  @return     idx of the frame whose page should be replaced.
+ ****************************************************************************************/
+int find_remove_aging(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm lru.
+ *
+ *  The frames form a doubly linked list ordered by their last access, so the victim
+ *  is the tail of the list.
+ *
+ *  @return     idx of the frame whose page should be replaced.
+ ****************************************************************************************/
+int find_remove_lru(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm arc (as CAR).
+ *
+ *  The victim moves to the ghost list B1 or B2 when it is evicted (on_evict).
+ *
+ *  @return     idx of the frame whose page should be replaced.
+ ****************************************************************************************/
+int find_remove_arc(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function inserts a page that has been put into memory into the
+ *              ARC lists. A page found in a ghost list adapts the target size of T1.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      page The page.
+ *
+ *  @param      frame The frame of the page.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void arc_insert(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm clock-pro.
+ *
+ *  A faulting page in its test period has been taken out of it by on_fault before 
+ *  the cold hand searches a victim. The cold hand stops on the victim, the victim
+ *  starts its test period when it is evicted (on_evict).
+ *
+ *  @return     idx of the frame whose page should be replaced.
+ ****************************************************************************************/
+int find_remove_clockpro(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function inserts a page that has been put into memory into the
+ *              CLOCK-Pro clock, as hot page if it faulted in its test period, as cold 
+ *              page otherwise.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      page The page.
+ *
+ *  @param      frame The frame of the page.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void clockpro_insert(struct vmem_adm_struct *adm, struct pt_struct *pt, int page, int frame);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm wsclock.
+ *
+ *  Dirty pages outside the working set are queued for writeback. When the victim 
+ *  is evicted (on_evict), the queued pages are handed to adm->writeback.
+ *
+ *  @return     idx of the frame whose page should be replaced.
+ ****************************************************************************************/
+int find_remove_wsclock(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function implements page replacement algorithm enhanced 
+ *              second chance.
+ *
+ *  @return     idx of the frame whose page should be replaced.
+ ****************************************************************************************/
+int find_remove_esc(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function moves a frame to the head of the LRU list.
+ *              It will be called on each access when lru page replacement algorithm 
+ *              is active.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      frame The accessed frame.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static inline void pagerep_lru_touch(struct vmem_adm_struct *adm, struct pt_struct *pt, int frame) {
+    struct lru_link *l = pt->lru;
+
+    if (adm->lru_head == frame) return;
+    // unlink, frame is not the head so it has a predecessor
+    l[l[frame].prev].next = l[frame].next;
+    if (l[frame].next != VOID_IDX) l[l[frame].next].prev = l[frame].prev;
+    else adm->lru_tail = l[frame].prev;
+    // insert as head
+    l[frame].prev = VOID_IDX;
+    l[frame].next = adm->lru_head;
+    l[adm->lru_head].prev = frame;
+    adm->lru_head = frame;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function returns the bits of the aging intervals first .. first + n - 1
+ *              (n < 16) in a 16 bit bitmap indexed by interval % 16.
+ *
+ *  @param      first First aging interval.
+ *
+ *  @param      n Number of intervals.
+ *
+ *  @return     The bitmap.
+ ****************************************************************************************/
+static inline unsigned int pagerep_hist_mask(int first, int n) {
+    unsigned int m = ((1u << n) - 1) << (first & 15);
+
+    return (m | (m >> 16)) & 0xffff;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function records a run of accesses to a frame for aging page 
+ *              replacement algorithm. It will be called by the application on each 
+ *              access and only touches the bitmap of the accessed frame.
+ *
+ *  @param      pt Page table.
+ *
+ *  @param      frame The accessed frame.
+ *
+ *  @param      g_first Global count of the first access of the run.
+ *
+ *  @param      g_last Global count of the last access of the run.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static inline void pagerep_age_ref(struct pt_struct *pt, int frame, int g_first, int g_last) {
+    int t_first = (g_first + UPDATE_AGE_COUNT - 1) / UPDATE_AGE_COUNT;
+    int t_last = (g_last + UPDATE_AGE_COUNT - 1) / UPDATE_AGE_COUNT;
+    int stale = t_last - pt->frametick[frame];
+    int span = t_last - t_first + 1;
+    unsigned int hist = pt->framehist[frame];
+
+    if (stale == 0 && span == 1) return;
+    // the bits of the intervals after frametick still belong to 16 intervals ago
+    hist = (stale >= 16) ? 0 : hist & ~pagerep_hist_mask(pt->frametick[frame] + 1, stale);
+    hist |= (span >= 16) ? 0xffff : pagerep_hist_mask(t_first, span);
+    pt->framehist[frame] = hist;
+    pt->frametick[frame] = t_last;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function does aging for aging page replacement algorithm.
+ *              It advances age_tick to the current aging interval, the ages follow
+ *              lazily. The buckets of the intervals that leave the last 8 move to 
+ *              age 0. It will be called by pagerep_alloc_frame, i.e. by the memory 
+ *              manager while the application waits for its fault.
+ *
+ *  @param      adm Admin data that holds geometry and replacement state.
+ *
+ *  @param      pt Page table.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void pagerep_age(struct vmem_adm_struct *adm, struct pt_struct *pt);
+
+#endif /* PAGEREP_H */
@@ -7,12 +7,42 @@
 
 #include "vmem.h"
 #include "debug.h"
-#include "signal.h"
+#include "vmaccess.h"
+#include "pagerep.h"
+#include "vmtrace.h"
+
+/**
+ * Number of entries of the TLB. Must be a power of two.
+ */
+#define VMEM_TLB_SIZE 16
+
+/**
+ * Maximal number of values vmem_copy moves per run
+ */
+#define VMEM_COPY_CHUNK 256
+
+/**
+ * Entry of the direct mapped software TLB. An entry is valid as long as the 
+ * generation counter of its frame has not changed since it was loaded.
+ */
+struct tlb_entry {
+    int page;           //!< cached page; VOID_IDX: unused entry
+    int frame;          //!< frame that stores page
+    unsigned int gen;   //!< pt.framegen[frame] when the entry was loaded
+};
+
 /*
  * static variables
  */
 
 static struct vmem_struct *vmem = NULL; //!< Reference to virtual memory
+static struct pt_struct pt;             //!< Page table arrays in shared memory
+static int *vmem_data;                  //!< Main memory in shared memory
+static int pagesize;                    //!< Page size published by mmanage
+static struct trace_writer *tracer = NULL; //!< Access trace, NULL: tracing disabled
+static struct tlb_entry tlb[VMEM_TLB_SIZE]; //!< Per process translation cache
+static const struct pagerep_policy *policy; //!< Page replacement policy selected by mmanage
+static int needs_access;                    //!< policy has flag PAGEREP_NEEDS_ACCESS
 
 /**
  *****************************************************************************************
@@ -29,40 +59,39 @@ static void vmem_init(void) {
 	key = ftok(SHMKEY , SHMPROCID);
 	TEST_AND_EXIT_ERRNO(key == -1,"ftok: ftok failed");
 
-	shmid = shmget(key, SHMSIZE, 0666 | IPC_CREAT);
-	TEST_AND_EXIT_ERRNO(shmid < 0, "shmget: shmget failed");
+	shmid = shmget(key, 0, 0666);
+	TEST_AND_EXIT_ERRNO(shmid < 0, "shmget: shmget failed - is mmanage running?");
 
 	vmem = (struct vmem_struct*) shmat(shmid, NULL, 0);
-	TEST_AND_EXIT_ERRNO(shmid < 0, "shmat: shmat failed");
+	TEST_AND_EXIT_ERRNO(vmem == (struct vmem_struct *) -1, "shmat: shmat failed");
 
-	sem_t *local_sem = sem_open(NAMED_SEM, 0); /* Open a preexisting semaphore. */
+	// geometry and layout are published by mmanage
+	vmem_data = vmem_map(vmem, &pt);
+	pagesize = vmem->adm.pagesize;
+	policy = pagerep_policy(&vmem->adm);
+	needs_access = (policy->flags & PAGEREP_NEEDS_ACCESS) != 0;
 
+	int i;
+	for(i = 0; i < VMEM_TLB_SIZE; i++) {
+		tlb[i].page = VOID_IDX;
+	}
 }
 
 /**
  *****************************************************************************************
- *  @brief      This function does aging for aging page replacement algorithm.
- *              It will be called periodic based on g_count.
- *              This function must be used only when aging page replacement algorithm is active.
- *              Otherwise update_age_reset_ref may interfere with other page replacement 
- *              algorithms that base on PTF_REF bit.
+ *  @brief      This function sets PTF_DIRTY of a page after it has been written.
+ *
+ *  The cleaner thread of mmanage may write the page back while the application 
+ *  runs. It clears PTF_DIRTY atomically before it copies the page, so the flag is
+ *  set atomically and only after the data: a write the copy missed leaves the page 
+ *  dirty.
  *
+ *  @param      page The written page.
+ * 
  *  @return     void
  ****************************************************************************************/
-static void update_age_reset_ref(void) {
-	int referencedBit;
-	int virtualPage;
-	int i;
-	for(i = 0; i < VMEM_NFRAMES; i++) {
-		virtualPage = vmem->pt.framepage[i];
-		if(virtualPage != VOID_IDX) {
-			referencedBit = vmem->pt.entries[virtualPage].flags & PTF_REF;
-			vmem->pt.entries[virtualPage].age = (vmem->pt.entries[virtualPage].age / 2);
-			referencedBit = referencedBit * 32;
-			vmem->pt.entries[virtualPage].age |= referencedBit;
-			vmem->pt.entries[virtualPage].flags &= ~PTF_REF;
-		}
-	}
+static void vmem_mark_dirty(int page) {
+	__atomic_fetch_or(&pt.entries[page].flags, PTF_DIRTY, __ATOMIC_RELEASE);
 }
 
 /**
@@ -70,58 +99,297 @@ static void update_age_reset_ref(void) {
  *  @brief      This function puts a page into memory (if required).
  *              It must be called by vmem_read and vmem_write
  *
+ *  The TLB is checked first. Only on a TLB miss the page table will be consulted
+ *  and, if the page is not present, a page fault will be posted to mmanage.
+ *  The first reference to a page read ahead by mmanage counts it as useful.
+ *  Policies with flag PAGEREP_INSERT_UNREF insert pages unreferenced, so for 
+ *  them the access that caused a page fault does not set PTF_REF. The flags are
+ *  updated atomically, as the cleaner thread of mmanage clears PTF_DIRTY at any time.
+ *
  *  @param      address The page that stores the contents of this address will be put in (if required).
+ *
+ *  @param      flags PTF_REF. Writes set PTF_DIRTY afterwards by vmem_mark_dirty.
  * 
- *  @return     void
+ *  @return     The frame that stores the page.
  ****************************************************************************************/
-static void vmem_put_page_into_mem(int page) {
-	if((vmem->pt.entries[page].flags & PTF_PRESENT) == 0) {
-		vmem->adm.pf_count++;
-		vmem->adm.req_pageno = page;
-
-		kill(vmem->adm.mmanage_pid, SIGUSR1);
-		sem_wait(sem_open(NAMED_SEM, 0));
+static int vmem_put_page_into_mem(int page, int flags) {
+	struct tlb_entry *e = &tlb[page & (VMEM_TLB_SIZE - 1)];
+	if(e->page == page && pt.framegen[e->frame] == e->gen) {
+		vmem->adm.tlb_hits++;
+	}
+	else {
+		// acquire: mmanage publishes the frame of a page read for an advice before PTF_PRESENT
+		if((__atomic_load_n(&pt.entries[page].flags, __ATOMIC_ACQUIRE) & PTF_PRESENT) == 0) {
+			vmem->adm.pf_count++;
+			fault_request(&vmem->adm, page);
+			if(policy->flags & PAGEREP_INSERT_UNREF) {
+				flags &= ~PTF_REF;
+			}
+		}
+		else if(pt.entries[page].flags & PTF_PREFETCH) {
+			// first reference to a page read ahead by mmanage
+			__atomic_fetch_and(&pt.entries[page].flags, ~PTF_PREFETCH, __ATOMIC_RELAXED);
+			vmem->adm.ra_useful++;
+		}
+		e->page = page;
+		e->frame = pt.entries[page].frame;
+		e->gen = pt.framegen[e->frame];
+		vmem->adm.tlb_misses++;
 	}
 	vmem->adm.g_count++;
+	if(needs_access) {
+		policy->on_access(&vmem->adm, &pt, page, e->frame, vmem->adm.g_count, vmem->adm.g_count);
+	}
+	if((pt.entries[page].flags & flags) != flags) {
+		__atomic_fetch_or(&pt.entries[page].flags, flags, __ATOMIC_RELAXED);
+	}
+	return e->frame;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function puts the page of address into memory and accounts for 
+ *              a run of accesses to this page.
+ *
+ *  The run starts at address and ends at the end of the page or after count accesses.
+ *  The bookkeeping equals *run single accesses: the global count advances by *run, 
+ *  the reference bit is set and the run is recorded in all aging intervals it covers.
+ *  The dirty bit of a write is left to the caller (vmem_mark_dirty).
+ *
+ *  @param      address The virtual memory address of the first access.
+ *
+ *  @param      count Maximal number of accesses.
+ *
+ *  @param      flags PTF_REF for reads, PTF_REF | PTF_DIRTY for writes.
+ *
+ *  @param      run Returns the number of accesses of this run.
+ * 
+ *  @return     Pointer to the data of address in main memory.
+ ****************************************************************************************/
+static int *vmem_page_run(int address, int count, int flags, int *run) {
+	int page_idx = address / pagesize;
+	int offset = address - (pagesize * page_idx);
+	int n = pagesize - offset;
+	if(n > count) {
+		n = count;
+	}
+
+	int frame_idx = vmem_put_page_into_mem(page_idx, flags & ~PTF_DIRTY);
+	int g_end = vmem->adm.g_count + n - 1;
+
+	if(__builtin_expect(tracer != NULL, 0)) {
+		int i;
+		for(i = 0; i < n; i++) {
+			trace_record(tracer, address + i, (flags & PTF_DIRTY) ? TRACE_WRITE : TRACE_READ);
+		}
+	}
+
+	if(n > 1 && (pt.entries[page_idx].flags & PTF_REF) == 0) {
+		__atomic_fetch_or(&pt.entries[page_idx].flags, PTF_REF, __ATOMIC_RELAXED);
+	}
+	if(n > 1 && needs_access) {
+		policy->on_access(&vmem->adm, &pt, page_idx, frame_idx, vmem->adm.g_count, g_end);
+	}
+	vmem->adm.tlb_hits += n - 1; // further accesses to the same page hit the TLB
+	vmem->adm.g_count = g_end;
+
+	*run = n;
+	return &vmem_data[(frame_idx * pagesize) + offset];
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function exits the application if a range of addresses is not 
+ *              inside the virtual address space selected by mmanage.
+ *
+ *  @param      func Name of the calling access function, for the error message.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      count Number of integer values of the range.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+static void vmem_check_range(const char *func, int address, int count) {
+	int size = vmem->adm.npages * pagesize;
+	TEST_AND_EXIT(address < 0 || count < 0 || address > size - count,
+	              (stderr, "%s: addresses %d .. %d out of virtual memory of size %d\n", 
+	               func, address, address + count - 1, size));
 }
 
 int vmem_read(int address) {
 	if(vmem == NULL) {
 		vmem_init();
 	}
-	int page_idx = address / VMEM_PAGESIZE;
-	int offset = address - (VMEM_PAGESIZE * page_idx);
-	vmem_put_page_into_mem(page_idx);
-
-	vmem->pt.entries[page_idx].flags |= PTF_REF;
-	if(vmem->adm.g_count % UPDATE_AGE_COUNT == 0 && vmem->adm.page_rep_algo == VMEM_ALGO_AGING) {
-		update_age_reset_ref();
+	vmem_check_range("vmem_read", address, 1);
+	if(__builtin_expect(tracer != NULL, 0)) {
+		trace_record(tracer, address, TRACE_READ);
 	}
-	page_idx = vmem->pt.entries[page_idx].frame;
-	return vmem->data[(page_idx * VMEM_PAGESIZE) + offset];
+	int page_idx = address / pagesize;
+	int offset = address - (pagesize * page_idx);
+	int frame_idx = vmem_put_page_into_mem(page_idx, PTF_REF);
+
+	return vmem_data[(frame_idx * pagesize) + offset];
 }
 
 void vmem_write(int address, int data) {
 	if(vmem == NULL) {
 		vmem_init();
 	}
+	vmem_check_range("vmem_write", address, 1);
+	if(__builtin_expect(tracer != NULL, 0)) {
+		trace_record(tracer, address, TRACE_WRITE);
+	}
+
+	int page_idx = address / pagesize;
+	int offset = address - (pagesize * page_idx);
+
+	int frame_idx = vmem_put_page_into_mem(page_idx, PTF_REF); //seite wurde referenziert
+
+	vmem_data[(frame_idx * pagesize) + offset] = data;
+	vmem_mark_dirty(page_idx); // und beschrieben
+}
+
+void vmem_read_range(int address, int *buf, int count) {
+	if(vmem == NULL) {
+		vmem_init();
+	}
+	vmem_check_range("vmem_read_range", address, count);
+	int run;
+	while(count > 0) {
+		int *src = vmem_page_run(address, count, PTF_REF, &run);
+		memcpy(buf, src, run * sizeof(int));
+		address += run;
+		buf += run;
+		count -= run;
+	}
+}
 
-	int page_idx = address / VMEM_PAGESIZE;
-	int offset = address - (VMEM_PAGESIZE * page_idx);
+void vmem_write_range(int address, const int *buf, int count) {
+	if(vmem == NULL) {
+		vmem_init();
+	}
+	vmem_check_range("vmem_write_range", address, count);
+	int run;
+	while(count > 0) {
+		int *dst = vmem_page_run(address, count, PTF_REF | PTF_DIRTY, &run);
+		memcpy(dst, buf, run * sizeof(int));
+		vmem_mark_dirty(address / pagesize);
+		address += run;
+		buf += run;
+		count -= run;
+	}
+}
+
+void vmem_copy(int dst, int src, int count) {
+	int buf[VMEM_COPY_CHUNK];
+	if(vmem == NULL) {
+		vmem_init();
+	}
+	vmem_check_range("vmem_copy", src, count);
+	vmem_check_range("vmem_copy", dst, count);
+	int backward = (dst > src) && (dst < src + count); // overlapping, copy from the end
+	while(count > 0) {
+		int n = (count < VMEM_COPY_CHUNK) ? count : VMEM_COPY_CHUNK;
+		int src_addr = backward ? src + count - 1 : src;
+		int dst_addr = backward ? dst + count - 1 : dst;
+		// run must stay within one page of source and destination
+		int src_room = backward ? src_addr % pagesize + 1 : pagesize - src_addr % pagesize;
+		int dst_room = backward ? dst_addr % pagesize + 1 : pagesize - dst_addr % pagesize;
+		if(n > src_room) {
+			n = src_room;
+		}
+		if(n > dst_room) {
+			n = dst_room;
+		}
+		if(backward) {
+			vmem_read_range(src + count - n, buf, n);
+			vmem_write_range(dst + count - n, buf, n);
+		}
+		else {
+			vmem_read_range(src, buf, n);
+			vmem_write_range(dst, buf, n);
+			src += n;
+			dst += n;
+		}
+		count -= n;
+	}
+}
 
-	vmem_put_page_into_mem(page_idx);
+/**
+ *****************************************************************************************
+ *  @brief      This function finds the pages that hold a part of a range of virtual 
+ *              memory. The range is clipped to the virtual address space.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      count Number of integer values of the range.
+ *
+ *  @param      first Returns the first page.
+ *
+ *  @return     Number of pages, 0 if the range is empty.
+ ****************************************************************************************/
+static int vmem_page_range(int address, int count, int *first) {
+	int last;
+	if(vmem == NULL) {
+		vmem_init();
+	}
+	if(count <= 0 || address >= vmem->adm.npages * pagesize || address + count <= 0) {
+		return 0;
+	}
+	*first = (address < 0) ? 0 : address / pagesize;
+	last = (address + count - 1) / pagesize;
+	if(last >= vmem->adm.npages) {
+		last = vmem->adm.npages - 1;
+	}
+	return last - *first + 1;
+}
 
-	vmem->pt.entries[page_idx].flags |= PTF_DIRTY; //seite wurde beschrieben
-	vmem->pt.entries[page_idx].flags |= PTF_REF; //seite wurde referenziert
-	if(vmem->adm.g_count % UPDATE_AGE_COUNT == 0 && vmem->adm.page_rep_algo == VMEM_ALGO_AGING) {
-		update_age_reset_ref();
+void vmem_advise(int address, int count, int advice) {
+	int first;
+	int npages = vmem_page_range(address, count, &first);
+	TEST_AND_EXIT(advice < VMEM_ADV_NORMAL || advice > VMEM_ADV_DONTNEED,
+	              (stderr, "vmem_advise: invalid advice %d\n", advice));
+	if(npages > 0) {
+		advise_request(&vmem->adm, first, npages, advice);
 	}
-	int frame_idx = vmem->pt.entries[page_idx].frame;
-	vmem->data[(frame_idx * VMEM_PAGESIZE) + offset] = data;
+}
 
+int vmem_lock(int address, int count) {
+	int first;
+	int npages = vmem_page_range(address, count, &first);
+	if(npages == 0) {
+		return 0;
+	}
+	return lock_request(&vmem->adm, first, npages, TRUE);
+}
 
+void vmem_unlock(int address, int count) {
+	int first;
+	int npages = vmem_page_range(address, count, &first);
+	if(npages > 0) {
+		lock_request(&vmem->adm, first, npages, FALSE);
+	}
+}
 
+void vmem_trace_start(const char *filename) {
+	static int exit_handler = FALSE;
+	vmem_trace_stop();
+	tracer = malloc(sizeof(struct trace_writer));
+	TEST_AND_EXIT_ERRNO(!tracer, "Error allocating trace buffer");
+	trace_writer_open(tracer, filename);
+	if(!exit_handler) {
+		atexit(vmem_trace_stop);
+		exit_handler = TRUE;
+	}
+}
 
+void vmem_trace_stop(void) {
+	if(tracer != NULL) {
+		trace_writer_close(tracer);
+		free(tracer);
+		tracer = NULL;
+	}
 }
 
 // EOF
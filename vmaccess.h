@@ -9,6 +9,21 @@
 #ifndef VMACCESS_H
 #define VMACCESS_H
 
+/*
+ * The access functions exit the application with an error if an address is outside
+ * the virtual address space selected by mmanage (-virtmemsize).
+ */
+
+/**
+ * Access advice for vmem_advise
+ */
+#define VMEM_ADV_NORMAL     0 //!< no special treatment, read-ahead adapts to the faults
+#define VMEM_ADV_RANDOM     1 //!< random accesses expected, no read-ahead
+#define VMEM_ADV_SEQUENTIAL 2 //!< sequential accesses expected, full read-ahead at once
+#define VMEM_ADV_WILLNEED   3 //!< the pages will be accessed soon, read them in now
+#define VMEM_ADV_DONTNEED   4 //!< the pages will not be accessed soon, replace them first
+
+
 /**
  *****************************************************************************************
  *  @brief      This function reads an integer value from virtual memory.
@@ -35,4 +50,133 @@ int vmem_read(int address);
  ****************************************************************************************/
 void vmem_write(int address, int data);
 
+/**
+ *****************************************************************************************
+ *  @brief      This function reads count consecutive integer values from virtual memory.
+ *
+ *  The range is translated once per page and copied page run by page run. Page faults,
+ *  global count, reference bits and aging behave as if vmem_read was called for each
+ *  address in ascending order.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      buf Buffer that receives count integer values.
+ *
+ *  @param      count Number of integer values to read.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_read_range(int address, int *buf, int count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes count consecutive integer values to virtual memory.
+ *
+ *  Page faults, global count, reference and dirty bits and aging behave as if vmem_write
+ *  was called for each address in ascending order.
+ *
+ *  @param      address The virtual memory address the first integer value should be written to.
+ *
+ *  @param      buf Buffer that holds count integer values.
+ *
+ *  @param      count Number of integer values to write.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_write_range(int address, const int *buf, int count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function copies count integer values inside virtual memory.
+ *
+ *  Overlapping ranges are allowed. The copy is done in runs that do not cross a page
+ *  boundary of source or destination; each run is read completely before it is written.
+ *
+ *  @param      dst The virtual memory address of the destination range.
+ *
+ *  @param      src The virtual memory address of the source range.
+ *
+ *  @param      count Number of integer values to copy.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_copy(int dst, int src, int count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function starts recording all accesses to virtual memory.
+ *
+ *  Each vmem_read / vmem_write (and each element of a range access) is recorded as 
+ *  (address, R/W) in a per process buffer that is written in delta and varint coded 
+ *  blocks to filename. See vmtrace.h for the format. A running trace is stopped first.
+ *  The trace is flushed at exit.
+ *
+ *  @param      filename Name of the trace file.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_trace_start(const char *filename);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function tells the memory manager how a range of virtual memory 
+ *              will be accessed.
+ *
+ *  The advice applies to all pages that hold a part of the range. VMEM_ADV_NORMAL, 
+ *  VMEM_ADV_RANDOM and VMEM_ADV_SEQUENTIAL stay in effect for the pages until the 
+ *  next advice of these three. VMEM_ADV_WILLNEED reads the pages into free frames, 
+ *  evicting other pages if needed. VMEM_ADV_DONTNEED writes dirty pages back and 
+ *  makes the pages the first to be replaced; their contents are kept.
+ *  The call waits until the memory manager has taken the advice.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      count Number of integer values of the range.
+ *
+ *  @param      advice One of VMEM_ADV_*.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_advise(int address, int count, int advice);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function locks a range of virtual memory in main memory.
+ *
+ *  The pages that hold a part of the range are read in if needed and are not 
+ *  replaced until they are unlocked. Locks do not nest: vmem_unlock unlocks a page 
+ *  however often it was locked. The memory manager limits the number of locked 
+ *  pages (mmanage -maxlocked). If the range would exceed the limit, no page of it 
+ *  is locked.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      count Number of integer values of the range.
+ * 
+ *  @return     0 if the range is locked, -1 if the limit of locked pages would be 
+ *              exceeded.
+ ****************************************************************************************/
+int vmem_lock(int address, int count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function unlocks the pages of a range of virtual memory locked by 
+ *              vmem_lock, they may be replaced again.
+ *
+ *  @param      address The virtual memory address of the first integer value.
+ *
+ *  @param      count Number of integer values of the range.
+ * 
+ *  @return     void
+ ****************************************************************************************/
+void vmem_unlock(int address, int count);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function stops recording and closes the trace file.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void vmem_trace_stop(void);
+
 #endif
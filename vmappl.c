@@ -122,6 +122,9 @@ static void print_usage_info_and_exit(char *err_str);
 static char *program_name = NULL;
 static int sort_algo      = QUICK_SORT; // select default sort algorithm
 static int seed           = SEED; // select default init value for random number generator 
+static char *trace_file   = NULL; // record all memory accesses into this file
+static int advise         = FALSE; // tell mmanage how the data will be accessed
+static int lock_pivot     = FALSE; // lock the reference element of quicksort in memory
 
 /* 
  * functions of the module 
@@ -134,6 +137,7 @@ void scan_params(int argc, char **argv) {
     unsigned char seed_param_found      = FALSE;
     unsigned char param_ok              = FALSE;
     const char *seed_str = "-seed=";
+    const char *trace_str = "-trace=";
 
     // scan all parameters (argv[0] points to program name)
     for (i = 1; i < argc; i++) {
@@ -160,6 +164,20 @@ void scan_params(int argc, char **argv) {
                 param_ok = TRUE;
             }
         }
+        if ( 0 == strncasecmp(trace_str, argv[i], strlen(trace_str)) && argv[i][strlen(trace_str)] != '\0' ) {
+            // trace file 
+            if (trace_file) print_usage_info_and_exit("Two trace files defined.\n");
+            trace_file = argv[i] + strlen(trace_str);
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-advise", argv[i])) {
+            advise = TRUE;
+            param_ok = TRUE;
+        }
+        if (0 == strcasecmp("-lock", argv[i])) {
+            lock_pivot = TRUE;
+            param_ok = TRUE;
+        }
         if (!param_ok) print_usage_info_and_exit("Undefined parameter.\n"); // undefined parameter found
     } // for loop
 }
@@ -178,6 +196,13 @@ int main(int argc, char **argv) {
         fprintf(stderr, "LENGTH (array size) out of range");
         exit(EXIT_FAILURE); 
     }
+    if (trace_file) {
+        vmem_trace_start(trace_file);
+    }
+    if (advise) {
+        // init and display scan the data, the sort accesses it in its own pattern
+        vmem_advise(0, LENGTH, VMEM_ADV_SEQUENTIAL);
+    }
     init_data(LENGTH);
     printf("init_data done\n");
     /* Display unsorted */
@@ -186,34 +211,53 @@ int main(int argc, char **argv) {
 
     /* Sort */
     printf("\nSorting:\n");
+    if (advise) {
+        vmem_advise(0, LENGTH, VMEM_ADV_NORMAL);
+    }
     sort(LENGTH);
+    if (advise) {
+        vmem_advise(0, LENGTH, VMEM_ADV_SEQUENTIAL);
+    }
 
     /* Display sorted */
     printf("\nSorted:\n");
     display_data(LENGTH);
     printf("\n");
 
+    if (trace_file) {
+        vmem_trace_stop();
+    }
     return 0;
 }
 
 void init_data(int length) {
-    int i;
-    int val;
+    int i, j;
+    int n;
+    int block[BLOCKSIZE];
 
     /* Init random generator */
     srand(seed);
 
-    for(i = 0; i < length; i++) {
-        val = rand() % RNDMOD;
-        vmem_write(i, val);
+    for(i = 0; i < length; i += n) {
+        n = (length - i < BLOCKSIZE) ? length - i : BLOCKSIZE;
+        for(j = 0; j < n; j++) {
+            block[j] = rand() % RNDMOD;
+        }
+        vmem_write_range(i, block, n);
     }   /* end for */
 }
 
 void display_data(int length) {
-    int i;
-    for(i = 0; i < length; i++) {
-        printf("%10d", vmem_read(i));
-        printf("%c", ((i + 1) % NDISPLAYCOLS) ? ' ' : '\n');
+    int i, j;
+    int n;
+    int block[BLOCKSIZE];
+    for(i = 0; i < length; i += n) {
+        n = (length - i < BLOCKSIZE) ? length - i : BLOCKSIZE;
+        vmem_read_range(i, block, n);
+        for(j = 0; j < n; j++) {
+            printf("%10d", block[j]);
+            printf("%c", ((i + j + 1) % NDISPLAYCOLS) ? ' ' : '\n');
+        }
     }   /* end for */
 }
 
@@ -247,6 +291,8 @@ void quicksort(int l, int r) {
     if(l < r) {
         int i = l;
         int j = r - 1;
+        /* [r] is read in each step, keep it in memory if mmanage allows */
+        int locked = lock_pivot && (vmem_lock(r, 1) == 0);
         while(1) {      /* Put all elements < [r] to the left */
             while(vmem_read(i) < vmem_read(r)) {
                 i++;
@@ -260,6 +306,9 @@ void quicksort(int l, int r) {
             swap(i, j);
         }       /* end while */
         swap(i, r);     /* Put reference elemet to the boundary */
+        if (locked) {
+            vmem_unlock(r, 1);
+        }
         /* Recursively sort the left and right half */
         quicksort(l, i - 1);
         quicksort(i + 1, r);
@@ -279,6 +328,9 @@ void print_usage_info_and_exit(char *err_str) {
     fprintf(stderr, " -bubblesort : Use bubblesort algorithm\n");
     fprintf(stderr, " -seed=<int value> : Init randon number generator for generating the numbers\n");
     fprintf(stderr, "                     of the array to be sorted with <int value>\n");
+    fprintf(stderr, " -trace=<file> : Record all memory accesses into <file>\n");
+    fprintf(stderr, " -advise : Advise the memory manager of sequential scans (vmem_advise)\n");
+    fprintf(stderr, " -lock : Lock the reference element of quicksort in memory (vmem_lock)\n");
     fflush(stderr);
     exit(EXIT_FAILURE);
 }
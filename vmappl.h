@@ -17,6 +17,7 @@
 #define RNDMOD 1000    //!< Second argument of modulo operator to shrink random numbers
 
 #define NDISPLAYCOLS 8 //!< Number of values printed in one line
+#define BLOCKSIZE   64 //!< Number of values transferred by one vmem_read_range / vmem_write_range call
 
 #define INIT_TYPE_SEED 0   // init array with random numbers
 #define INIT_TYPE_UP   1   // init array with increasing numbers
@@ -0,0 +1,266 @@
+/**
+ * @file vmem.c
+ * @brief Helper functions shared by mmanage and vmaccess.
+ *
+ * This module computes the layout of the shared memory for the memory
+ * geometry selected at runtime.
+ *
+ * It also implements the page fault channel located in the admin
+ * area of the shared memory. The application posts a request into the
+ * channel and the memory manager completes it. A request is a page
+ * fault, an access advice (vmem_advise) or a request to lock pages in
+ * memory (vmem_lock, vmem_unlock). Both sides spin for a
+ * short time before they block on a futex, so a fault round trip does
+ * not depend on signal delivery and scheduling. A side that blocks 
+ * counts itself in fault_sleepers, so the other side only makes the 
+ * FUTEX_WAKE system call when somebody sleeps. The application blocks
+ * with a timeout and exits if mmanage has died.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include "debug.h"
+#include "vmem.h"
+
+/**
+ * Hint to the CPU that we are in a spin loop.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/**
+ * Alignment of the arrays in shared memory (cache line size)
+ */
+#define VMEM_ALIGN 64
+
+/**
+ * Round x up to a multiple of VMEM_ALIGN
+ */
+#define VMEM_ALIGN_UP(x) (((x) + VMEM_ALIGN - 1) & ~((size_t) VMEM_ALIGN - 1))
+
+static int fault_spin = -1; //!< Number of polls before blocking, 0 on uniprocessors
+
+/**
+ *****************************************************************************************
+ *  @brief      This function blocks while *addr still contains val.
+ *
+ *  The futex is not private: the word lives in SysV shared memory and is shared by
+ *  two processes.
+ *
+ *  @param      addr Address of the futex word.
+ *
+ *  @param      val Expected value of the futex word.
+ *
+ *  @param      timeout Maximal time to block, NULL: no limit.
+ *
+ *  @return     TRUE if the timeout expired.
+ ****************************************************************************************/
+static int futex_wait(int *addr, int val, const struct timespec *timeout) {
+    if (syscall(SYS_futex, addr, FUTEX_WAIT, val, timeout, NULL, 0) == -1) {
+        TEST_AND_EXIT_ERRNO(errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT, "futex wait failed");
+        return errno == ETIMEDOUT;
+    }
+    return FALSE;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function wakes up all processes blocked on the futex word addr.
+ *
+ *  @param      addr Address of the futex word.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void futex_wake(int *addr) {
+    TEST_AND_EXIT_ERRNO(syscall(SYS_futex, addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0) == -1,
+                        "futex wake failed");
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sets a new fault state and wakes the other side if it
+ *              sleeps.
+ *
+ *  The store of the state and the load of fault_sleepers are sequentially consistent,
+ *  like the increment of fault_sleepers and the load of the state by the sleeper. So
+ *  either the sleeper sees the new state, or this function sees the sleeper.
+ *
+ *  @param      adm Admin area that holds the fault channel.
+ *
+ *  @param      state The new state.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void fault_set_state(struct vmem_adm_struct *adm, int state) {
+    __atomic_store_n(&adm->fault_state, state, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&adm->fault_sleepers, __ATOMIC_SEQ_CST) > 0) {
+        futex_wake(&adm->fault_state);
+    }
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function waits until the fault state differs from state.
+ *
+ *  It spins up to VMEM_FAULT_SPIN times before it blocks on the futex. On a 
+ *  uniprocessor spinning only delays the other side, so it blocks at once.
+ *  If peer is given, the waiter wakes up every VMEM_FAULT_TIMEOUT_MS and exits 
+ *  with an error if the process peer does not exist any more.
+ *
+ *  @param      adm Admin area that holds the fault channel.
+ *
+ *  @param      state The state to wait for to be left.
+ *
+ *  @param      peer Process that has to leave the state, 0: wait without limit.
+ *
+ *  @return     The new fault state.
+ ****************************************************************************************/
+static int fault_wait_while(struct vmem_adm_struct *adm, int state, pid_t peer) {
+    struct timespec timeout = { VMEM_FAULT_TIMEOUT_MS / 1000, (VMEM_FAULT_TIMEOUT_MS % 1000) * 1000000L };
+    int cur;
+    int i;
+
+    if (fault_spin < 0) {
+        fault_spin = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? VMEM_FAULT_SPIN : 0;
+    }
+    for (i = 0; i < fault_spin; i++) {
+        cur = __atomic_load_n(&adm->fault_state, __ATOMIC_ACQUIRE);
+        if (cur != state) return cur;
+        CPU_RELAX();
+    }
+    __atomic_add_fetch(&adm->fault_sleepers, 1, __ATOMIC_SEQ_CST);
+    while ((cur = __atomic_load_n(&adm->fault_state, __ATOMIC_SEQ_CST)) == state) {
+        if (futex_wait(&adm->fault_state, state, peer ? &timeout : NULL)) {
+            TEST_AND_EXIT(kill(peer, 0) == -1 && errno == ESRCH,
+                          (stderr, "mmanage (pid %d) has terminated\n", (int) peer));
+        }
+    }
+    __atomic_sub_fetch(&adm->fault_sleepers, 1, __ATOMIC_SEQ_CST);
+    return cur;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function posts the request set up in the admin area and waits 
+ *              until mmanage has completed it.
+ *
+ *  @param      adm Admin area that holds the fault channel.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void fault_post(struct vmem_adm_struct *adm) {
+    fault_set_state(adm, FAULT_REQUEST);
+
+    fault_wait_while(adm, FAULT_REQUEST, adm->mmanage_pid);
+    __atomic_store_n(&adm->fault_state, FAULT_IDLE, __ATOMIC_RELAXED);
+}
+
+size_t vmem_layout(struct vmem_adm_struct *adm, int pagesize, int npages, int nframes) {
+    size_t off = VMEM_ALIGN_UP(sizeof(struct vmem_struct));
+
+    adm->pagesize = pagesize;
+    adm->npages = npages;
+    adm->nframes = nframes;
+    adm->size = pagesize * npages;
+
+    adm->entries_off = off;
+    off = VMEM_ALIGN_UP(off + npages * sizeof(struct pt_entry));
+    adm->framepage_off = off;
+    off = VMEM_ALIGN_UP(off + nframes * sizeof(int));
+    adm->framegen_off = off;
+    off = VMEM_ALIGN_UP(off + nframes * sizeof(unsigned int));
+    adm->lru_off = off;
+    off = VMEM_ALIGN_UP(off + nframes * sizeof(struct lru_link));
+    adm->pagelink_off = off;
+    off = VMEM_ALIGN_UP(off + npages * sizeof(struct lru_link));
+    adm->pagestate_off = off;
+    off = VMEM_ALIGN_UP(off + npages * sizeof(unsigned char));
+    adm->wbqueue_off = off;
+    off = VMEM_ALIGN_UP(off + nframes * sizeof(int));
+    adm->frameage_off = off;
+    off = VMEM_ALIGN_UP(off + nframes * sizeof(unsigned char));
+    adm->framehist_off = off;
+    off = VMEM_ALIGN_UP(off + nframes * sizeof(unsigned short));
+    adm->frametick_off = off;
+    off = VMEM_ALIGN_UP(off + nframes * sizeof(int));
+    adm->framebase_off = off;
+    off = VMEM_ALIGN_UP(off + nframes * sizeof(int));
+    adm->agezero_off = off;
+    off = VMEM_ALIGN_UP(off + AGEZERO_WORDS(nframes) * sizeof(unsigned long long));
+    adm->freeframes_off = off;
+    off = VMEM_ALIGN_UP(off + nframes * sizeof(int));
+    adm->data_off = off;
+    off = VMEM_ALIGN_UP(off + (size_t) nframes * pagesize * sizeof(int));
+
+    adm->shm_size = off;
+    return off;
+}
+
+int *vmem_map(struct vmem_struct *vmem, struct pt_struct *pt) {
+    char *base = (char *) vmem;
+
+    pt->entries = (struct pt_entry *) (base + vmem->adm.entries_off);
+    pt->framepage = (int *) (base + vmem->adm.framepage_off);
+    pt->framegen = (unsigned int *) (base + vmem->adm.framegen_off);
+    pt->lru = (struct lru_link *) (base + vmem->adm.lru_off);
+    pt->pagelink = (struct lru_link *) (base + vmem->adm.pagelink_off);
+    pt->pagestate = (unsigned char *) (base + vmem->adm.pagestate_off);
+    pt->wbqueue = (int *) (base + vmem->adm.wbqueue_off);
+    pt->frameage = (unsigned char *) (base + vmem->adm.frameage_off);
+    pt->framehist = (unsigned short *) (base + vmem->adm.framehist_off);
+    pt->frametick = (int *) (base + vmem->adm.frametick_off);
+    pt->framebase = (int *) (base + vmem->adm.framebase_off);
+    pt->agezero = (unsigned long long *) (base + vmem->adm.agezero_off);
+    pt->freeframes = (int *) (base + vmem->adm.freeframes_off);
+    return (int *) (base + vmem->adm.data_off);
+}
+
+void fault_init(struct vmem_adm_struct *adm) {
+    adm->req_pageno = VOID_IDX;
+    adm->req_advice = VOID_IDX;
+    adm->fault_sleepers = 0;
+    __atomic_store_n(&adm->fault_state, FAULT_IDLE, __ATOMIC_RELEASE);
+}
+
+void fault_request(struct vmem_adm_struct *adm, int page) {
+    adm->req_advice = VOID_IDX;
+    adm->req_pageno = page;
+    fault_post(adm);
+}
+
+void advise_request(struct vmem_adm_struct *adm, int page, int npages, int advice) {
+    adm->req_npages = npages;
+    adm->req_pageno = page;
+    adm->req_advice = advice;
+    fault_post(adm);
+}
+
+int lock_request(struct vmem_adm_struct *adm, int page, int npages, int lock) {
+    adm->req_npages = npages;
+    adm->req_pageno = page;
+    adm->req_advice = lock ? VMEM_REQ_LOCK : VMEM_REQ_UNLOCK;
+    adm->req_result = 0;
+    fault_post(adm);
+    return adm->req_result;
+}
+
+int fault_wait_request(struct vmem_adm_struct *adm) {
+    int cur = __atomic_load_n(&adm->fault_state, __ATOMIC_ACQUIRE);
+
+    // DONE -> IDLE is the client acknowledging the last request, keep waiting
+    while (cur != FAULT_REQUEST) {
+        cur = fault_wait_while(adm, cur, 0);
+    }
+    return adm->req_pageno;
+}
+
+void fault_complete(struct vmem_adm_struct *adm) {
+    fault_set_state(adm, FAULT_DONE);
+}
+
+// EOF
@@ -8,6 +8,8 @@
  * Dec 2015 : Set memory algorithm vi command line parameter 
  * Dec 2015 : Set define for PAGESIZE and VMEM_ALGO via compiler -D option (Franz Korf, HAW Hamburg)
  * Dec 2015 : Add some documentation (Franz Korf, HAW Hamburg)
+ * Page faults are passed via a futex based channel in shared memory instead of SIGUSR1
+ * Memory geometry is set at runtime, shared memory layout is computed by vmem_layout
  */
 
 #ifndef VMEM_H
@@ -18,7 +20,6 @@
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
-#include <semaphore.h>
 #include <sys/stat.h>
 #include <sys/fcntl.h>
 #include <sys/types.h>
@@ -30,7 +31,18 @@
 #define SHMKEY          "./vmem.h" //!< First paremater for shared memory generation via ftok function
 #define SHMPROCID       1234       //!< Second paremater for shared memory generation via ftok function
 
-#define NAMED_SEM       "sem_vm_simulation_OS_X" //!< For OS-X semaphore
+/**
+ * States of the page fault channel in vmem_adm_struct.fault_state
+ */
+#define FAULT_IDLE      0 //!< No request pending
+#define FAULT_REQUEST   1 //!< Application has posted the page in req_pageno
+#define FAULT_DONE      2 //!< mmanage has put the requested page into memory
+
+#define VMEM_REQ_LOCK   16 //!< req_advice of a request to lock pages, beside VMEM_ADV_* of vmaccess.h
+#define VMEM_REQ_UNLOCK 17 //!< req_advice of a request to unlock pages
+
+#define VMEM_FAULT_SPIN 4000 //!< Number of polls before a fault channel waiter blocks on the futex
+#define VMEM_FAULT_TIMEOUT_MS 1000 //!< Period in which a blocked application checks that mmanage is alive
 
 /**
  * Constants for page replacement algorithms
@@ -39,25 +51,28 @@
 #define VMEM_ALGO_FIFO  0
 #define VMEM_ALGO_AGING 1
 #define VMEM_ALGO_CLOCK 2
+#define VMEM_ALGO_LRU   3
+#define VMEM_ALGO_ARC   4   //!< ARC, implemented as its clock based variant CAR
+#define VMEM_ALGO_CLOCKPRO 5
+#define VMEM_ALGO_WSCLOCK  6
+#define VMEM_ALGO_ESC      7   //!< enhanced second chance, i.e. CLOCK on the NRU classes (ref, dirty)
 
-// Following defines will be sets via compiler parameter / Makefile
-// VMEM_PAGESIZE :                    values 8 16 32 64
-// default values
+// The memory geometry is selected by command line parameters of mmanage and
+// published in vmem_adm_struct. The following defines are the default values.
 
 /**
- * Constant VMEM_PAGESIZE will be sete via compiler -D option. 
+ * Default page size. It may be set via compiler -D option. 
  * Default value : 8
- * value range : 8 16 32 64 
  */
 #ifndef VMEM_PAGESIZE
 #define VMEM_PAGESIZE 8
 #endif
 
-/* Sizes */
-#define VMEM_VIRTMEMSIZE 1024   //!< Size of virtual address space of the process
-#define VMEM_PHYSMEMSIZE  128   //!< Size of physical memory
-#define VMEM_NPAGES     (VMEM_VIRTMEMSIZE / VMEM_PAGESIZE)  //!< Total number of pages 
-#define VMEM_NFRAMES (VMEM_PHYSMEMSIZE / VMEM_PAGESIZE)     //!< Total number of (page) frames 
+/* Default sizes */
+#define VMEM_VIRTMEMSIZE 1024   //!< Default size of virtual address space of the process
+#define VMEM_PHYSMEMSIZE  128   //!< Default size of physical memory
+
+#define VMEM_WS_TAU      1000   //!< Default working set window of WSClock in accesses (g_count)
 
 /**
  * page table flags used by this simulation
@@ -65,6 +80,8 @@
 #define PTF_PRESENT     1
 #define PTF_DIRTY       2 //!< store: need to write 
 #define PTF_REF         4       
+#define PTF_PREFETCH    8 //!< read ahead by mmanage and not referenced since
+#define PTF_LOCKED     16 //!< locked in memory by vmem_lock, never replaced
 
 #define VOID_IDX -1       //!< Constant for invalid page or frame reference 
 
@@ -74,8 +91,23 @@
 struct pt_entry {
    int flags;             //!< See definition of PTF_* flags 
    int frame;             //!< Frame idx; frame == VOID_IDX: unvalid reference  
-   int count;             //!< Global counter as quasi-timestamp for LRU page replacement algorithm
-   unsigned char age;     //!< 8 bit counter for aging page replacement algorithm
+   int count;             //!< Global counter as quasi-timestamp for LRU and WSClock (time of last use) page replacement algorithms
+};
+
+/**
+ * Link of a frame in the LRU list or of a page in a page list of ARC / CLOCK-Pro
+ */
+struct lru_link {
+   int prev;              //!< more recently used frame, VOID_IDX for the head
+   int next;              //!< less recently used frame, VOID_IDX for the tail
+};
+
+/**
+ * Circular doubly linked list of pages, linked by pt_struct.pagelink
+ */
+struct page_list {
+   int head;              //!< first page (position of the clock hand), VOID_IDX if empty
+   int size;              //!< number of pages in the list
 };
 
 /**
@@ -83,46 +115,222 @@ struct pt_entry {
  */
 struct vmem_adm_struct {
     int size;                    //!< size of virtual memory supported by mmanage
+    int pagesize;                //!< size of a page
+    int npages;                  //!< total number of pages
+    int nframes;                 //!< total number of (page) frames
+    size_t shm_size;             //!< size of the shared memory segment
+    size_t entries_off;          //!< offset of the page table in the shared memory
+    size_t framepage_off;        //!< offset of the frame to page mapping in the shared memory
+    size_t framegen_off;         //!< offset of the frame generation counters in the shared memory
+    size_t lru_off;              //!< offset of the LRU list in the shared memory
+    size_t pagelink_off;         //!< offset of the page list links in the shared memory
+    size_t pagestate_off;        //!< offset of the page list states in the shared memory
+    size_t wbqueue_off;          //!< offset of the writeback queue in the shared memory
+    size_t frameage_off;         //!< offset of the frame ages in the shared memory
+    size_t framehist_off;        //!< offset of the frame reference bitmaps in the shared memory
+    size_t frametick_off;        //!< offset of the frame reference intervals in the shared memory
+    size_t framebase_off;        //!< offset of the intervals of the frame ages in the shared memory
+    size_t agezero_off;          //!< offset of the bitmap of the frames of age 0 in the shared memory
+    size_t freeframes_off;       //!< offset of the free frame stack in the shared memory
+    size_t data_off;             //!< offset of the main memory in the shared memory
     pid_t mmanage_pid;           //!< process id if mmanage - will be used for sending signals to mmanage
     int shm_id;                  //!< shared memory id. Will be used to destroy shared memory when mmanage terminates
     int req_pageno;              //!< number of requested page 
+    int req_advice;              //!< VMEM_ADV_* or VMEM_REQ_* of a request, VOID_IDX for a page fault
+    int req_npages;              //!< number of pages of a request, starting at req_pageno
+    int req_result;              //!< result of a lock request: 0, VOID_IDX if too many pages would be locked
+    int fault_state;             //!< page fault channel state, see FAULT_*. Also used as futex word
+    int fault_sleepers;          //!< number of processes blocked or about to block on fault_state
     int next_alloc_idx;          //!< next frame to allocate by FIFO and CLOCK page replacement algorithm
+    int lru_head;                //!< most recently used frame
+    int lru_tail;                //!< least recently used frame, the victim of LRU
+    struct page_list arc_list[4];//!< ARC: clocks T1, T2 and ghost lists B1, B2 (index pagestate - 1)
+    int arc_p;                   //!< ARC: target size of T1
+    struct page_list cp_clock;   //!< CLOCK-Pro: the clock, its head is HAND_hot
+    int cp_hand_cold;            //!< CLOCK-Pro: HAND_cold, next resident cold page to check
+    int cp_hand_test;            //!< CLOCK-Pro: HAND_test, next page whose test period may end
+    int cp_cold_target;          //!< CLOCK-Pro: target number of resident cold pages
+    int cp_hot;                  //!< CLOCK-Pro: number of hot pages
+    int cp_cold;                 //!< CLOCK-Pro: number of resident cold pages
+    int cp_test;                 //!< CLOCK-Pro: number of non-resident cold pages in their test period
+    int ws_tau;                  //!< WSClock: pages not used for more than ws_tau accesses leave the working set
+    int wb_pending;              //!< number of frames in the writeback queue
+    int age_tick;                //!< Aging: last aging interval that was shifted into the ages
+    int age_bucket[8];           //!< Aging: first frame last referenced in interval t, t % 8, for the last 8 intervals
+    int nfree;                   //!< number of frames on the free frame stack
+    int nlocked;                 //!< number of pages locked in memory (PTF_LOCKED)
     int pf_count;                //!< page fault counter 
+    int wb_count;                //!< writeback counter, pages stored to the pagefile
+    int ra_count;                //!< pages read ahead by mmanage
+    int ra_useful;               //!< pages read ahead and referenced, counted by vmaccess
+    int ra_wasted;               //!< pages read ahead and evicted without a reference
     int g_count;                 //!< global acces counter as quasi-timestamp - will be increment by each memory access
+    int tlb_hits;                //!< accesses translated by the TLB of vmaccess
+    int tlb_misses;              //!< accesses that had to look up the page table
     unsigned char page_rep_algo; // !< page replacement algorithm
+    int pagerep_hooks;           //!< PAGEREP_HOOK_* bits of the optional hooks of the policy, set by pagerep_init
     char *program_name;          //!< program name
+    void (*writeback)(void *ctx, int frame); //!< writes back the page in frame for the replacement algorithm, valid in the process that runs it
+    void *writeback_ctx;         //!< first argument of writeback
 };
 
 /**
- * This structure contains
+ * This structure references
    - page table 
    - mapping form frame idx to page idx (for each frame the page stored in this frame currently
+ * The arrays are located in shared memory behind the admin data. Their sizes depend 
+ * on the geometry in vmem_adm_struct, so each process sets up its own pt_struct 
+ * via vmem_map.
  */
 struct pt_struct {
     /* page table */
-    struct pt_entry entries[VMEM_NPAGES]; //!< page table 
-    int framepage[VMEM_NFRAMES];          //!< Gives for each frame the page stored in this frame.  VOID_IDX indicates an unused frame.A
+    struct pt_entry *entries;    //!< page table, npages entries 
+    int *framepage;              //!< Gives for each frame the page stored in this frame.  VOID_IDX indicates an unused frame.A
+    unsigned int *framegen;      //!< Incremented whenever the page in a frame is removed. Invalidates TLB entries of vmaccess.
+    struct lru_link *lru;        //!< All frames ordered by their last access, see lru_head and lru_tail. Aging: age buckets.
+    struct lru_link *pagelink;   //!< Links of the page lists of ARC and CLOCK-Pro, npages entries.
+    unsigned char *pagestate;    //!< List membership of each page for ARC and CLOCK-Pro, see pagerep.c.
+    int *wbqueue;                //!< Frames whose pages the replacement algorithm wants written back.
+    unsigned char *frameage;     //!< 8 bit age of the page in each frame for aging page replacement algorithm, as of framebase.
+    unsigned short *framehist;   //!< Aging: bit (t % 16) is set if the frame was referenced in aging interval t.
+    int *frametick;              //!< Aging: last aging interval the frame was referenced in, validates framehist.
+    int *framebase;              //!< Aging: aging interval up to which frameage is shifted.
+    unsigned long long *agezero; //!< Aging: bitmap of the frames of age 0, followed by a bitmap of its non-zero words.
+    int *freeframes;             //!< Stack of the unused frames, the smallest frame on top, see nfree.
 };
 
 /* This is to be located in shared memory */
 /**
- * The data structure stored in shared memory
+ * The data structure stored in shared memory. The admin data is followed by the 
+ * page table arrays and the main memory (nframes * pagesize ints) used by virtual 
+ * memory simulation. See vmem_layout.
  */
 struct vmem_struct {
     struct vmem_adm_struct adm;              //!< admin data
-    struct pt_struct pt;                     //!< page table 
-    int data[VMEM_NFRAMES * VMEM_PAGESIZE];  //!< main memory used by virtual memory simulation
 };
 
-#define SHMSIZE (sizeof(struct vmem_struct)) //!< size of virtual memory 
-
 // for aging algo
 
 /**
  * UPDATE_AGE_COUNT will be used by aging page replacement algorithm. 
  * When (g_count % UPDATE_AGE_COUNT) == 0 : UPDATE_AGE_COUNT quasi time units has passed
- * and aging algorithm will be executed. 
+ * and aging algorithm will be executed. The access g_count belongs to aging interval
+ * (g_count + UPDATE_AGE_COUNT - 1) / UPDATE_AGE_COUNT.
  */
 #define UPDATE_AGE_COUNT   20
 
+/**
+ * Number of 64 bit words of pt_struct.agezero for nframes frames
+ */
+#define AGEZERO_WORDS(nframes) (((nframes) + 63) / 64 + ((nframes) + 64 * 64 - 1) / (64 * 64))
+
+/**
+ *****************************************************************************************
+ *  @brief      This function computes the layout of the shared memory for a geometry.
+ *
+ *  It stores the geometry, the offsets of all arrays and the total size in adm.
+ *
+ *  @param      adm Admin data that receives the layout.
+ *
+ *  @param      pagesize Size of a page.
+ *
+ *  @param      npages Number of pages of the virtual address space.
+ *
+ *  @param      nframes Number of frames of the physical memory.
+ *
+ *  @return     Size of the shared memory segment.
+ ****************************************************************************************/
+size_t vmem_layout(struct vmem_adm_struct *adm, int pagesize, int npages, int nframes);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function sets up the references into shared memory for this process.
+ *
+ *  @param      vmem Shared memory whose layout has been set up by vmem_layout.
+ *
+ *  @param      pt Receives the references to the page table arrays.
+ *
+ *  @return     Start of main memory.
+ ****************************************************************************************/
+int *vmem_map(struct vmem_struct *vmem, struct pt_struct *pt);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function resets the page fault channel.
+ *              It will be called by mmanage when the shared memory is created.
+ *
+ *  @param      adm Admin area that holds the fault channel.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void fault_init(struct vmem_adm_struct *adm);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function posts a page fault to mmanage and waits until the
+ *              requested page is in memory.
+ *
+ *  @param      adm Admin area that holds the fault channel.
+ *
+ *  @param      page The page that should be put into memory.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void fault_request(struct vmem_adm_struct *adm, int page);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function posts an access advice to mmanage and waits until it has 
+ *              been taken. It uses the page fault channel.
+ *
+ *  @param      adm Admin area that holds the fault channel.
+ *
+ *  @param      page First page of the range.
+ *
+ *  @param      npages Number of pages of the range.
+ *
+ *  @param      advice VMEM_ADV_* as defined in vmaccess.h.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void advise_request(struct vmem_adm_struct *adm, int page, int npages, int advice);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function posts a request to lock or unlock pages to mmanage and 
+ *              waits until it has been done. It uses the page fault channel.
+ *
+ *  @param      adm Admin area that holds the fault channel.
+ *
+ *  @param      page First page of the range.
+ *
+ *  @param      npages Number of pages of the range.
+ *
+ *  @param      lock TRUE: lock the pages, FALSE: unlock them.
+ *
+ *  @return     0, or VOID_IDX if mmanage refused to lock the pages.
+ ****************************************************************************************/
+int lock_request(struct vmem_adm_struct *adm, int page, int npages, int lock);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function waits for the next page fault posted by the application.
+ *
+ *  @param      adm Admin area that holds the fault channel.
+ *
+ *  @return     The requested page.
+ ****************************************************************************************/
+int fault_wait_request(struct vmem_adm_struct *adm);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function signals the application that the current page fault 
+ *              has been handled.
+ *
+ *  @param      adm Admin area that holds the fault channel.
+ *
+ *  @return     void
+ ****************************************************************************************/
+void fault_complete(struct vmem_adm_struct *adm);
+
 #endif /* VMEM_H */
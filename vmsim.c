@@ -0,0 +1,615 @@
+/**
+ * @file vmsim.c
+ * @brief Offline page replacement simulator.
+ *
+ * vmsim replays memory access traces recorded by vmappl -trace=<file>
+ * with the page replacement algorithms of mmanage (module pagerep). Every
+ * combination of trace, algorithm, page size and number of frames is a
+ * job. Jobs run in parallel on a pool of threads, each on a private page
+ * table, and print the number of page faults and writebacks.
+ *
+ * The fault sequence is the one mmanage produces for the same access
+ * sequence, so the page fault count equals the last "Page fault" line
+ * of logfile.txt.
+ *
+ * In addition vmsim implements Belady's OPT (MIN): replace the page whose
+ * next use is farthest in the future. It needs the future of the trace,
+ * so mmanage cannot run it, but its fault count is a lower bound for
+ * every other algorithm.
+ *
+ * With -curve vmsim computes fault curves instead, one job per trace and
+ * page size: LRU page faults for every number of frames from 1 to the
+ * number of pages (Mattson's stack distances) and the working set curve,
+ * i.e. mean working set size and page faults for windows of 2^k accesses.
+ *
+ * Usage: vmsim [-algo=fifo,clock,aging,lru,arc,clockpro,wsclock,esc,opt]
+ *              [-pagesize=8,16,32,64] [-frames=n,...] [-tau=n]
+ *              [-threads=n] [-curve] trace ...
+ * -algo accepts the names of all policies in pagerep_policies and opt.
+ * Default for algo: all of them.
+ * Default for frames: VMEM_PHYSMEMSIZE / pagesize, as in mmanage.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "debug.h"
+#include "vmem.h"
+#include "pagerep.h"
+#include "vmtrace.h"
+
+#define VMSIM_MAXLIST 32  //!< Maximal number of values of a list parameter
+
+#define VMSIM_ALGO_OPT PAGEREP_NPOLICIES        //!< Belady's OPT, only available in vmsim
+#define VMSIM_CURVE    (PAGEREP_NPOLICIES + 1)  //!< LRU and working set fault curves
+
+/**
+ * Fault curves of one trace and page size
+ */
+struct curve {
+    int npages;          //!< number of pages
+    long *lru_faults;    //!< LRU page faults for 0..npages frames
+    int nwindows;        //!< number of working set windows
+    size_t *window;      //!< window sizes in accesses
+    double *ws_size;     //!< mean working set size for each window
+    long *ws_faults;     //!< working set page faults for each window
+};
+
+/**
+ * One simulation run
+ */
+struct sim_job {
+    int trace;      //!< index into traces
+    int algo;       //!< VMEM_ALGO_*, VMSIM_ALGO_OPT or VMSIM_CURVE
+    int pagesize;   //!< page size in ints
+    int nframes;    //!< number of frames
+    int pagefaults; //!< result: page faults
+    int writebacks; //!< result: dirty pages written back to the pagefile
+    struct curve curve; //!< result of VMSIM_CURVE
+};
+
+static struct trace *traces;     //!< decoded traces
+static struct sim_job *jobs;     //!< all jobs
+static int njobs;                //!< number of jobs
+static int next_job = 0;         //!< next job to be taken by a worker
+static int ws_tau = VMEM_WS_TAU; //!< working set window of WSClock
+
+/**
+ *****************************************************************************************
+ *  @brief      This function prints usage info and terminates the process.
+ *
+ *  @param      prog Name of the program.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void print_usage_info_and_exit(const char *prog) {
+    int i;
+    fprintf(stderr, "Usage: %s [-algo=", prog);
+    for (i = 0; i < PAGEREP_NPOLICIES; i++) {
+        fprintf(stderr, "%s,", pagerep_policies[i].name);
+    }
+    fprintf(stderr, "opt] [-pagesize=n,...] [-frames=n,...] [-tau=n] [-threads=n] [-curve] trace ...\n");
+    exit(EXIT_FAILURE);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function parses a comma separated list of positive numbers.
+ *
+ *  @param      str The list.
+ *
+ *  @param      vals Receives the values.
+ *
+ *  @return     Number of values or -1 if str is not a valid list.
+ ****************************************************************************************/
+static int parse_list(const char *str, int *vals) {
+    int n = 0;
+    char *end;
+
+    do {
+        if (n == VMSIM_MAXLIST) return -1;
+        vals[n] = (int) strtol(str, &end, 10);
+        if (end == str || vals[n] <= 0) return -1;
+        n++;
+        str = end + 1;
+    } while (*end == ',');
+    return (*end == '\0') ? n : -1;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function counts a page the replacement algorithm writes back.
+ *
+ *  @param      ctx The job.
+ *
+ *  @param      frame The frame of the page.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void count_writeback(void *ctx, int frame) {
+    (void) frame;
+    ((struct sim_job *) ctx)->writebacks++;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function replays a trace for one job.
+ *
+ *  The page table and admin data are private to the job. The bookkeeping per
+ *  access is the one of vmaccess: page fault if the page is not present,
+ *  g_count, PTF_REF / PTF_DIRTY and aging every UPDATE_AGE_COUNT accesses.
+ *
+ *  @param      job The job. Receives the results.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void simulate(struct sim_job *job) {
+    const struct trace *t = &traces[job->trace];
+    int npages = t->max_addr / job->pagesize + 1;
+    struct vmem_adm_struct lay = { 0 }; // g_count and the statistics start at 0
+    struct vmem_struct *vmem;
+    struct pt_struct pt;
+    struct vmem_adm_struct *adm;
+    const struct pagerep_policy *policy;
+    int needs_access;
+    size_t i;
+
+    vmem = calloc(1, vmem_layout(&lay, job->pagesize, npages, job->nframes));
+    TEST_AND_EXIT_ERRNO(!vmem, "Error allocating page table");
+    vmem->adm = lay;
+    vmem_map(vmem, &pt);
+    adm = &vmem->adm;
+    adm->page_rep_algo = job->algo;
+    adm->ws_tau = ws_tau;
+    adm->writeback = count_writeback;
+    adm->writeback_ctx = job;
+    pagerep_init(adm, &pt);
+    policy = pagerep_policy(adm);
+    needs_access = (policy->flags & PAGEREP_NEEDS_ACCESS) != 0;
+
+    job->pagefaults = 0;
+    job->writebacks = 0;
+    for (i = 0; i < t->n; i++) {
+        int page = (t->refs[i] >> 1) / job->pagesize;
+        struct pt_entry *e = &pt.entries[page];
+        int ref = PTF_REF;
+
+        if (!(e->flags & PTF_PRESENT)) {
+            int replaced;
+            int frame;
+            frame = pagerep_alloc_frame(adm, &pt, page, &replaced);
+            if (replaced != VOID_IDX && (pt.entries[replaced].flags & PTF_DIRTY)) {
+                pt.entries[replaced].flags &= ~PTF_DIRTY;
+                job->writebacks++;
+            }
+            pagerep_map_page(adm, &pt, page, frame);
+            job->pagefaults++;
+            if (policy->flags & PAGEREP_INSERT_UNREF) ref = 0;
+        }
+        adm->g_count++;
+        if (needs_access) policy->on_access(adm, &pt, page, e->frame, adm->g_count, adm->g_count);
+        e->flags |= ref;
+        if (t->refs[i] & TRACE_WRITE) e->flags |= PTF_DIRTY;
+    }
+    free(vmem);
+}
+
+/**
+ * Max heap of the used frames, ordered by the next use of their pages
+ */
+struct opt_heap {
+    int *frames;     //!< heap of frame numbers
+    int *pos;        //!< position of each frame in frames
+    size_t *key;     //!< next use of the page in each frame
+    int n;           //!< number of frames in the heap
+};
+
+/**
+ *****************************************************************************************
+ *  @brief      This function swaps two heap positions.
+ ****************************************************************************************/
+static void opt_swap(struct opt_heap *h, int a, int b) {
+    int fa = h->frames[a];
+    int fb = h->frames[b];
+
+    h->frames[a] = fb;
+    h->frames[b] = fa;
+    h->pos[fb] = a;
+    h->pos[fa] = b;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function moves a frame whose key has grown towards the root.
+ *
+ *  @param      h The heap.
+ *
+ *  @param      i Heap position of the frame.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void opt_sift_up(struct opt_heap *h, int i) {
+    while (i > 0 && h->key[h->frames[(i - 1) / 2]] < h->key[h->frames[i]]) {
+        opt_swap(h, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function moves a frame whose key has shrunk towards the leaves.
+ *
+ *  @param      h The heap.
+ *
+ *  @param      i Heap position of the frame.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void opt_sift_down(struct opt_heap *h, int i) {
+    for (;;) {
+        int l = 2 * i + 1;
+        int max = i;
+        if (l < h->n && h->key[h->frames[l]] > h->key[h->frames[max]]) max = l;
+        if (l + 1 < h->n && h->key[h->frames[l + 1]] > h->key[h->frames[max]]) max = l + 1;
+        if (max == i) return;
+        opt_swap(h, i, max);
+        i = max;
+    }
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function replays a trace for one job with Belady's OPT.
+ *
+ *  A reverse scan computes for each access the position of the next access to the
+ *  same page. The frames are kept in a max heap ordered by the next use of their
+ *  pages, so the victim is the root and each access costs O(log frames).
+ *
+ *  @param      job The job. Receives the results.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void simulate_opt(struct sim_job *job) {
+    const struct trace *t = &traces[job->trace];
+    int npages = t->max_addr / job->pagesize + 1;
+    size_t *next = malloc(t->n * sizeof(size_t));
+    size_t *last = malloc(npages * sizeof(size_t));
+    int *pageframe = malloc(npages * sizeof(int));
+    unsigned char *dirty = calloc(npages, 1);
+    int *framepage = malloc(job->nframes * sizeof(int));
+    struct opt_heap h;
+    size_t i;
+    int p;
+
+    h.frames = malloc(job->nframes * sizeof(int));
+    h.pos = malloc(job->nframes * sizeof(int));
+    h.key = malloc(job->nframes * sizeof(size_t));
+    h.n = 0;
+    TEST_AND_EXIT_ERRNO(!next || !last || !pageframe || !dirty || !framepage || !h.frames || !h.pos || !h.key,
+                        "Error allocating OPT tables");
+
+    // next use of each access, t->n if the page is never used again
+    for (p = 0; p < npages; p++) {
+        last[p] = t->n;
+        pageframe[p] = VOID_IDX;
+    }
+    for (i = t->n; i-- > 0;) {
+        int page = (t->refs[i] >> 1) / job->pagesize;
+        next[i] = last[page];
+        last[page] = i;
+    }
+
+    job->pagefaults = 0;
+    job->writebacks = 0;
+    for (i = 0; i < t->n; i++) {
+        int page = (t->refs[i] >> 1) / job->pagesize;
+        int frame = pageframe[page];
+
+        if (frame == VOID_IDX) {
+            if (h.n < job->nframes) {
+                frame = h.n;
+                h.frames[h.n] = frame;
+                h.pos[frame] = h.n++;
+            }
+            else {
+                int victim;
+                frame = h.frames[0];
+                victim = framepage[frame];
+                if (dirty[victim]) {
+                    dirty[victim] = 0;
+                    job->writebacks++;
+                }
+                pageframe[victim] = VOID_IDX;
+            }
+            framepage[frame] = page;
+            pageframe[page] = frame;
+            job->pagefaults++;
+        }
+        // a hit moves the key up, a replacement may move it down
+        h.key[frame] = next[i];
+        opt_sift_down(&h, h.pos[frame]);
+        opt_sift_up(&h, h.pos[frame]);
+        if (t->refs[i] & TRACE_WRITE) dirty[page] = 1;
+    }
+
+    free(next);
+    free(last);
+    free(pageframe);
+    free(dirty);
+    free(framepage);
+    free(h.frames);
+    free(h.pos);
+    free(h.key);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function computes the fault curves of a trace for one page size.
+ *
+ *  The stack distance of an access is the number of distinct pages referenced since 
+ *  the last access to the same page, plus one. LRU with n frames faults exactly on the
+ *  accesses with a stack distance > n and on first accesses (Mattson et al.). 
+ *  A Fenwick tree over the access positions marks the position of the most recent 
+ *  access of each page, so a stack distance is a prefix sum difference and the whole 
+ *  trace costs O(N log N).
+ *
+ *  The working set with window w faults on accesses whose distance in time to the
+ *  previous access of the page is > w. An access keeps its page in the working set
+ *  for min(w, distance to the next access of the page or to the end of the trace)
+ *  accesses, so the mean size is (1/N) * sum over k < w of the number of such forward
+ *  distances > k (Denning and Schwartz, without the stationarity approximation).
+ *
+ *  @param      job The job. Receives the results in job->curve.
+ *
+ *  @return     void
+ ****************************************************************************************/
+static void stack_distance(struct sim_job *job) {
+    const struct trace *t = &traces[job->trace];
+    struct curve *c = &job->curve;
+    int tpages = t->max_addr / job->pagesize + 1;
+    size_t *last = malloc(tpages * sizeof(size_t));
+    int *fenwick = calloc(t->n + 1, sizeof(int));
+    long *dist, *interref, *tail;
+    long cold = 0;
+    long acc, tacc;
+    double size;
+    size_t i, w;
+    int p;
+
+    c->npages = VMEM_VIRTMEMSIZE / job->pagesize;
+    if (c->npages < tpages) c->npages = tpages;
+    dist = calloc(c->npages + 1, sizeof(long));
+    interref = calloc(t->n + 1, sizeof(long));
+    tail = calloc(t->n + 1, sizeof(long));
+    c->lru_faults = malloc((c->npages + 1) * sizeof(long));
+    c->nwindows = 0;
+    for (w = 1; w < t->n; w *= 2) c->nwindows++;
+    c->nwindows++;
+    c->window = malloc(c->nwindows * sizeof(size_t));
+    c->ws_size = malloc(c->nwindows * sizeof(double));
+    c->ws_faults = malloc(c->nwindows * sizeof(long));
+    TEST_AND_EXIT_ERRNO(!last || !fenwick || !dist || !interref || !tail || !c->lru_faults || 
+                        !c->window || !c->ws_size || !c->ws_faults, "Error allocating curve tables");
+
+    for (p = 0; p < tpages; p++) last[p] = SIZE_MAX;
+    for (i = 0; i < t->n; i++) {
+        int page = (t->refs[i] >> 1) / job->pagesize;
+        size_t k;
+
+        if (last[page] == SIZE_MAX) {
+            cold++;
+        }
+        else {
+            // distinct pages in (last, i): marks at positions last + 2 .. i (1 based)
+            long d = 1;
+            for (k = i; k > 0; k -= k & -k) d += fenwick[k];
+            for (k = last[page] + 1; k > 0; k -= k & -k) d -= fenwick[k];
+            dist[d]++;
+            interref[i - last[page]]++;
+            for (k = last[page] + 1; k <= t->n; k += k & -k) fenwick[k]--;
+        }
+        for (k = i + 1; k <= t->n; k += k & -k) fenwick[k]++;
+        last[page] = i;
+    }
+    // distance of the last access of each page to the end of the trace
+    for (p = 0; p < tpages; p++) {
+        if (last[p] != SIZE_MAX) tail[t->n - last[p]]++;
+    }
+
+    // LRU faults with n frames: first accesses and stack distances > n
+    acc = 0;
+    for (p = c->npages; p >= 0; p--) {
+        c->lru_faults[p] = cold + acc;
+        acc += dist[p];
+    }
+
+    // working set: faults(w) = first accesses + interreference distances > w
+    acc = t->n - cold;
+    tacc = cold;
+    size = 0.0;
+    p = 0;
+    for (w = 0; w <= t->n && p < c->nwindows; w++) {
+        long faults = cold + acc;
+        if (w > 0 && (w == t->n || (w & (w - 1)) == 0)) {
+            c->window[p] = w;
+            c->ws_size[p] = size;
+            c->ws_faults[p] = faults;
+            p++;
+        }
+        size += (double) (acc + tacc) / t->n;
+        if (w < t->n) {
+            acc -= interref[w + 1];
+            tacc -= tail[w + 1];
+        }
+    }
+    c->nwindows = p;
+
+    free(last);
+    free(fenwick);
+    free(dist);
+    free(interref);
+    free(tail);
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function is the worker thread. It runs jobs until all are taken.
+ *
+ *  @param      arg unused
+ *
+ *  @return     NULL
+ ****************************************************************************************/
+static void *worker(void *arg) {
+    int j;
+
+    (void) arg;
+    while ((j = __atomic_fetch_add(&next_job, 1, __ATOMIC_RELAXED)) < njobs) {
+        if (jobs[j].algo == VMSIM_CURVE) stack_distance(&jobs[j]);
+        else if (jobs[j].algo == VMSIM_ALGO_OPT) simulate_opt(&jobs[j]);
+        else simulate(&jobs[j]);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int algos[VMSIM_MAXLIST];
+    int nalgos = 0;
+    int pagesizes[VMSIM_MAXLIST] = { 8, 16, 32, 64 };
+    int npagesizes = 4;
+    int frames[VMSIM_MAXLIST];
+    int nframes = 0;
+    int nthreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int curve = FALSE;
+    int ntraces;
+    pthread_t *threads;
+    int i, a, s, f, j;
+
+    // default: all policies and OPT
+    for (a = 0; a < PAGEREP_NPOLICIES; a++) algos[nalgos++] = a;
+    algos[nalgos++] = VMSIM_ALGO_OPT;
+
+    // parameters, the remaining arguments are trace files
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (0 == strncasecmp("-algo=", argv[i], strlen("-algo="))) {
+            char *list = strdup(argv[i] + strlen("-algo="));
+            char *tok;
+            nalgos = 0;
+            for (tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+                if (nalgos == VMSIM_MAXLIST) print_usage_info_and_exit(argv[0]);
+                if (0 == strcasecmp("opt", tok)) algos[nalgos++] = VMSIM_ALGO_OPT;
+                else if ((a = pagerep_find_policy(tok)) != VOID_IDX) algos[nalgos++] = a;
+                else print_usage_info_and_exit(argv[0]);
+            }
+            free(list);
+            if (nalgos == 0) print_usage_info_and_exit(argv[0]);
+        }
+        else if (0 == strncasecmp("-pagesize=", argv[i], strlen("-pagesize="))) {
+            npagesizes = parse_list(argv[i] + strlen("-pagesize="), pagesizes);
+            if (npagesizes < 0) print_usage_info_and_exit(argv[0]);
+        }
+        else if (0 == strncasecmp("-frames=", argv[i], strlen("-frames="))) {
+            nframes = parse_list(argv[i] + strlen("-frames="), frames);
+            if (nframes < 0) print_usage_info_and_exit(argv[0]);
+        }
+        else if (0 == strncasecmp("-threads=", argv[i], strlen("-threads="))) {
+            if (1 != sscanf(argv[i] + strlen("-threads="), "%d", &nthreads) || nthreads <= 0) {
+                print_usage_info_and_exit(argv[0]);
+            }
+        }
+        else if (0 == strncasecmp("-tau=", argv[i], strlen("-tau="))) {
+            if (1 != sscanf(argv[i] + strlen("-tau="), "%d", &ws_tau) || ws_tau <= 0) {
+                print_usage_info_and_exit(argv[0]);
+            }
+        }
+        else if (0 == strcasecmp("-curve", argv[i])) {
+            curve = TRUE;
+        }
+        else {
+            print_usage_info_and_exit(argv[0]);
+        }
+    }
+    ntraces = argc - i;
+    if (ntraces == 0) print_usage_info_and_exit(argv[0]);
+
+    traces = malloc(ntraces * sizeof(struct trace));
+    TEST_AND_EXIT_ERRNO(!traces, "Error allocating traces");
+    for (j = 0; j < ntraces; j++) {
+        trace_load(argv[i + j], &traces[j]);
+    }
+
+    // curves are computed for all frame counts at once
+    if (curve) {
+        algos[0] = VMSIM_CURVE;
+        nalgos = 1;
+        nframes = 0;
+    }
+
+    // one job per trace x algorithm x page size x frames
+    jobs = malloc((size_t) ntraces * nalgos * npagesizes * (nframes ? nframes : 1) * sizeof(struct sim_job));
+    TEST_AND_EXIT_ERRNO(!jobs, "Error allocating jobs");
+    njobs = 0;
+    for (j = 0; j < ntraces; j++) {
+        for (s = 0; s < npagesizes; s++) {
+            for (a = 0; a < nalgos; a++) {
+                for (f = 0; f < (nframes ? nframes : 1); f++) {
+                    struct sim_job *job = &jobs[njobs++];
+                    job->trace = j;
+                    job->algo = algos[a];
+                    job->pagesize = pagesizes[s];
+                    job->nframes = nframes ? frames[f] : VMEM_PHYSMEMSIZE / pagesizes[s];
+                    if (job->nframes < 1) job->nframes = 1;
+                }
+            }
+        }
+    }
+
+    if (nthreads > njobs) nthreads = njobs;
+    threads = malloc(nthreads * sizeof(pthread_t));
+    TEST_AND_EXIT_ERRNO(!threads, "Error allocating threads");
+    for (j = 0; j < nthreads; j++) {
+        TEST_AND_EXIT(pthread_create(&threads[j], NULL, worker, NULL) != 0,
+                      (stderr, "Error creating worker thread\n"));
+    }
+    for (j = 0; j < nthreads; j++) {
+        pthread_join(threads[j], NULL);
+    }
+
+    for (j = 0; j < njobs; j++) {
+        struct sim_job *job = &jobs[j];
+        if (job->algo == VMSIM_CURVE) {
+            struct curve *c = &job->curve;
+            const struct trace *t = &traces[job->trace];
+            for (f = 1; f <= c->npages; f++) {
+                printf("trace = %s pagesize = %4i frames = %5i lru_pagefaults %7ld miss_ratio %.6f \n",
+                       argv[i + job->trace], job->pagesize, f, c->lru_faults[f],
+                       (double) c->lru_faults[f] / t->n);
+            }
+            for (f = 0; f < c->nwindows; f++) {
+                printf("trace = %s pagesize = %4i window = %7zu ws_size %8.2f ws_pagefaults %7ld miss_ratio %.6f \n",
+                       argv[i + job->trace], job->pagesize, c->window[f], c->ws_size[f], c->ws_faults[f],
+                       (double) c->ws_faults[f] / t->n);
+            }
+            free(c->lru_faults);
+            free(c->window);
+            free(c->ws_size);
+            free(c->ws_faults);
+            continue;
+        }
+        printf("trace = %s page_rep_algo = %7s pagesize = %4i frames = %5i pagefaults %7d writebacks %7d \n",
+               argv[i + job->trace], job->algo == VMSIM_ALGO_OPT ? "OPT" : pagerep_policies[job->algo].label,
+               job->pagesize, job->nframes, job->pagefaults, job->writebacks);
+    }
+
+    for (j = 0; j < ntraces; j++) {
+        free(traces[j].refs);
+    }
+    free(traces);
+    free(jobs);
+    free(threads);
+    return 0;
+}
+
+// EOF
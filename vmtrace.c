@@ -0,0 +1,91 @@
+/**
+ * @file vmtrace.c
+ * @brief This module writes and reads memory access traces.
+ *
+ * See vmtrace.h for the file format.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "debug.h"
+#include "vmtrace.h"
+
+void trace_writer_open(struct trace_writer *w, const char *name) {
+    struct trace_header hdr = { TRACE_MAGIC, 1 };
+
+    w->file = fopen(name, "w");
+    TEST_AND_EXIT_ERRNO(!w->file, "Error creating trace file");
+    TEST_AND_EXIT_ERRNO(fwrite(&hdr, sizeof(hdr), 1, w->file) != 1, "Error writing trace file");
+    w->len = 0;
+    w->nrec = 0;
+    w->last_addr = 0;
+}
+
+void trace_writer_flush(struct trace_writer *w) {
+    uint32_t blkhdr[2];
+
+    if (w->nrec == 0) return;
+    blkhdr[0] = w->nrec;
+    blkhdr[1] = (uint32_t) w->len;
+    TEST_AND_EXIT_ERRNO(fwrite(blkhdr, sizeof(blkhdr), 1, w->file) != 1, "Error writing trace file");
+    TEST_AND_EXIT_ERRNO(fwrite(w->buf, 1, w->len, w->file) != w->len, "Error writing trace file");
+    w->len = 0;
+    w->nrec = 0;
+    w->last_addr = 0;
+}
+
+void trace_writer_close(struct trace_writer *w) {
+    trace_writer_flush(w);
+    TEST_AND_EXIT_ERRNO(fclose(w->file) == EOF, "Error closing trace file");
+    w->file = NULL;
+}
+
+void trace_load(const char *name, struct trace *t) {
+    struct trace_header hdr;
+    uint32_t blkhdr[2];
+    uint8_t *buf = malloc(TRACE_BLOCKSIZE);
+    size_t cap = 1 << 16;
+    FILE *f = fopen(name, "r");
+
+    TEST_AND_EXIT_ERRNO(!f, "Error opening trace file");
+    TEST_AND_EXIT(fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != TRACE_MAGIC || hdr.version != 1,
+                  (stderr, "%s: not a trace file\n", name));
+
+    t->n = 0;
+    t->max_addr = 0;
+    t->refs = malloc(cap * sizeof(int));
+    TEST_AND_EXIT_ERRNO(!t->refs || !buf, "Error allocating trace");
+
+    while (fread(blkhdr, sizeof(blkhdr), 1, f) == 1) {
+        size_t pos = 0;
+        uint32_t i;
+        int addr = 0;
+
+        TEST_AND_EXIT(blkhdr[1] > TRACE_BLOCKSIZE || fread(buf, 1, blkhdr[1], f) != blkhdr[1],
+                      (stderr, "%s: truncated block\n", name));
+        if (t->n + blkhdr[0] > cap) {
+            while (t->n + blkhdr[0] > cap) cap *= 2;
+            t->refs = realloc(t->refs, cap * sizeof(int));
+            TEST_AND_EXIT_ERRNO(!t->refs, "Error allocating trace");
+        }
+        for (i = 0; i < blkhdr[0]; i++) {
+            uint64_t v = 0;
+            int shift = 0;
+            uint32_t zz;
+            do {
+                TEST_AND_EXIT(pos >= blkhdr[1], (stderr, "%s: corrupt block\n", name));
+                v |= (uint64_t) (buf[pos] & 0x7f) << shift;
+                shift += 7;
+            } while (buf[pos++] & 0x80);
+            zz = (uint32_t) (v >> 1);
+            addr = (int) ((uint32_t) addr + ((zz >> 1) ^ (0u - (zz & 1))));
+            t->refs[t->n++] = (addr << 1) | (int) (v & 1);
+            if (addr > t->max_addr) t->max_addr = addr;
+        }
+    }
+    TEST_AND_EXIT_ERRNO(ferror(f), "Error reading trace file");
+    fclose(f);
+    free(buf);
+}
+
+// EOF
@@ -0,0 +1,127 @@
+/**
+ * @file vmtrace.h
+ * @brief Header file of the memory access trace module.
+ *
+ * A trace file records the reference string of an application: every
+ * vmem_read / vmem_write as (address, R/W). It starts with a struct 
+ * trace_header and consists of blocks. Each block starts with two 32 bit
+ * words, the number of records and the number of payload bytes. Each 
+ * record is a varint of (zigzag(address - previous address) << 1) | write.
+ * The previous address is 0 at the beginning of each block.
+ */
+
+#ifndef VMTRACE_H
+#define VMTRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TRACE_MAGIC      0x52544d56  //!< "VMTR", first word of a trace file
+#define TRACE_BLOCKSIZE  (64 * 1024) //!< Payload bytes per block
+#define TRACE_MAXREC     10          //!< Maximal size of one varint coded record
+
+#define TRACE_READ   0  //!< record of vmem_read
+#define TRACE_WRITE  1  //!< record of vmem_write
+
+/**
+ * Header of a trace file
+ */
+struct trace_header {
+    uint32_t magic;    //!< TRACE_MAGIC
+    uint32_t version;  //!< format version, currently 1
+};
+
+/**
+ * State of a trace that is being written
+ */
+struct trace_writer {
+    FILE *file;                    //!< trace file
+    uint8_t buf[TRACE_BLOCKSIZE];  //!< payload of the current block
+    size_t len;                    //!< used bytes of buf
+    uint32_t nrec;                 //!< records in the current block
+    int last_addr;                 //!< address of the previous record in this block
+};
+
+/**
+ * A decoded trace
+ */
+struct trace {
+    int *refs;    //!< (address << 1) | write for each access
+    size_t n;     //!< number of accesses
+    int max_addr; //!< largest address referenced
+};
+
+/**
+ *****************************************************************************************
+ *  @brief      This function creates a new trace file.
+ *
+ *  @param      w Writer state.
+ *
+ *  @param      name Name of the trace file.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void trace_writer_open(struct trace_writer *w, const char *name);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function writes the current block to the trace file.
+ *
+ *  @param      w Writer state.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void trace_writer_flush(struct trace_writer *w);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function flushes and closes a trace file.
+ *
+ *  @param      w Writer state.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void trace_writer_close(struct trace_writer *w);
+
+/**
+ *****************************************************************************************
+ *  @brief      This function appends one access to a trace.
+ *
+ *  @param      w Writer state.
+ *
+ *  @param      address Accessed virtual address.
+ *
+ *  @param      rw TRACE_READ or TRACE_WRITE.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+static inline void trace_record(struct trace_writer *w, int address, int rw) {
+    int32_t delta;
+    uint64_t v;
+
+    // flush first, a new block starts with last_addr 0
+    if (w->len > TRACE_BLOCKSIZE - TRACE_MAXREC) trace_writer_flush(w);
+    delta = (int32_t) ((uint32_t) address - (uint32_t) w->last_addr);
+    v = ((uint64_t) (((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31)) << 1) | rw;
+    while (v >= 0x80) {
+        w->buf[w->len++] = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    w->buf[w->len++] = (uint8_t) v;
+    w->last_addr = address;
+    w->nrec++;
+}
+
+/**
+ *****************************************************************************************
+ *  @brief      This function reads and decodes a complete trace file.
+ *
+ *  @param      name Name of the trace file.
+ *
+ *  @param      t Receives the decoded trace. t->refs must be freed by the caller.
+ *
+ *  @return     void 
+ ****************************************************************************************/
+void trace_load(const char *name, struct trace *t);
+
+#endif /* VMTRACE_H */